@@ -0,0 +1,73 @@
+#ifndef SIGMIDI_ANALYTICS_H
+#define SIGMIDI_ANALYTICS_H
+
+#include <sigmidi.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Live practice statistics over a sliding window.
+ *
+ * The window is a ring of ANALYTICS_BUCKET_MS buckets with running totals:
+ * a note adds to the newest bucket and the totals, a bucket leaving the
+ * window is subtracted from the totals and cleared. Every update is O(1) in
+ * fixed memory, nothing is rescanned.
+ *
+ * The note hooks and analytics_tick() run on the core thread, which publishes
+ * struct AnalyticsSnapshot under a seqlock for analytics_read().
+ */
+#define ANALYTICS_WINDOW_MS 10000
+#define ANALYTICS_BUCKET_MS 500
+// Notes below this (middle C) count as left hand
+#define ANALYTICS_HAND_SPLIT 60
+#define ANALYTICS_VELOCITY_BINS 16
+// Note ons closer together than this are one chord
+#define ANALYTICS_CHORD_MS 30
+// Timing is measured against the nearest sixteenth note
+#define ANALYTICS_GRID_DIVISION 4
+
+enum AnalyticsHand {
+    ANALYTICS_LEFT,
+    ANALYTICS_RIGHT,
+    ANALYTICS_HAND_COUNT,
+};
+
+struct AnalyticsHandStats {
+    uint32_t notes;
+    double velocity_mean;
+    double velocity_stddev;
+    uint32_t velocity_hist[ANALYTICS_VELOCITY_BINS]; // bins of 128 / BINS
+    double duration_mean_ms; // of the notes released in the window
+};
+
+struct AnalyticsSnapshot {
+    int span_ms; // covered by the window, less than the window right after start
+    uint32_t notes;
+    double notes_per_sec;
+    uint32_t key_hits[128];
+    uint32_t max_key_hits;
+    struct AnalyticsHandStats hands[ANALYTICS_HAND_COUNT];
+
+    uint32_t onsets;      // chords and single notes
+    double chord_density; // notes per onset
+
+    bool clock_grid; // timing measured against the MIDI clock, else the set tempo
+    uint32_t timed_notes;
+    double timing_mean_ms; // negative is early
+    double timing_abs_ms;
+    double timing_stddev_ms;
+};
+
+// Core thread
+void analytics_note_on(const struct Note *note);
+void analytics_note_off(const struct Note *note);
+// Expire old buckets and publish, cheap enough for every core loop
+void analytics_tick(int now_ms);
+
+// Any thread
+// Grid the timing is measured against while there is no MIDI clock, the one
+// the renderer draws: beats at origin_ns + n * 60 s / bpm on the monotonic clock
+void analytics_set_manual_grid(double bpm, uint64_t origin_ns);
+bool analytics_read(struct AnalyticsSnapshot *out);
+
+#endif // SIGMIDI_ANALYTICS_H
@@ -0,0 +1,40 @@
+#ifndef SIGMIDI_CLOCK_H
+#define SIGMIDI_CLOCK_H
+
+#include <sigmidi.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * MIDI clock follower. Clock ticks are filtered by a second order delay-locked
+ * loop, which estimates the tick period and phase from the arrival times and
+ * keeps USB jitter out of the beat position. Dropped ticks are recognised and
+ * skipped over, a run of ticks far from the prediction restarts the lock.
+ *
+ * clock_handle_event() runs on the core thread, is O(1) per event and never
+ * allocates. It publishes struct ClockState under a seqlock for the renderer.
+ */
+#define CLOCK_PPQN 24
+// Without a tick for this many periods the follower loses its lock
+#define CLOCK_LOST_TICKS 8
+
+struct ClockState {
+    bool running;     // between START/CONTINUE and STOP
+    bool locked;      // tempo has settled and ticks are still coming in
+    uint64_t tick;    // song position of the last tick, in clocks
+    double tick_ns;   // filtered monotonic time of that tick
+    double period_ns; // filtered time between ticks
+    double jitter_ns; // mean absolute error of the arrivals against the loop
+    uint64_t last_arrival_ns;
+};
+
+// Feeds CLOCK, START, CONTINUE, STOP and SONGPOS events, ignores the rest
+void clock_handle_event(const struct MidiEvent *event);
+// Consistent copy of the published state, false if it could not be taken
+bool clock_read(struct ClockState *out);
+// Interpolated position in beats at a monotonic time, false unless running
+// and locked
+bool clock_beat_at(const struct ClockState *state, uint64_t ns, double *beat);
+double clock_bpm(const struct ClockState *state);
+
+#endif // SIGMIDI_CLOCK_H
@@ -0,0 +1,64 @@
+#ifndef SIGMIDI_HISTORY_H
+#define SIGMIDI_HISTORY_H
+
+#include <sigmidi.h>
+#include <stddef.h>
+
+/*
+ * Scrollback history of notes retired by gc_note_queue().
+ *
+ * Notes are delta + varint encoded into fixed size blocks (~6 bytes a note),
+ * the oldest blocks are dropped once they fall out of HISTORY_HORIZON_MS or
+ * the blocks exceed HISTORY_MAX_BLOCK_BYTES. Alongside, every retired note is
+ * accumulated into per-key density bins at HISTORY_LEVEL_COUNT resolutions, so
+ * a zoomed out view can draw one rectangle per key and bin instead of every
+ * note.
+ *
+ * history_append() is called from the core thread, the queries from the render
+ * thread. Queries copy what is visible into a buffer owned by the caller and
+ * release the lock before it draws anything, so the core thread is never held
+ * up by a frame.
+ */
+#define HISTORY_HORIZON_MS (60 * 60 * 1000)
+#define HISTORY_BLOCK_SIZE 4096
+#define HISTORY_MAX_BLOCK_BYTES (32 << 20)
+#define HISTORY_LEVEL_COUNT 3
+#define HISTORY_KEYS 128
+
+struct HistoryBin {
+    int key;
+    int start_ms;
+    float occupancy; // fraction of the bin during which the key was sounding
+};
+
+// Caller owned query results, reused across queries and grown as needed.
+// Start zeroed, release items with free()
+struct HistoryNotes {
+    struct Note *items;
+    int count;
+    int capacity;
+};
+
+struct HistoryBins {
+    struct HistoryBin *items;
+    int count;
+    int capacity;
+    int bin_ms;
+};
+
+void history_init();
+void history_free();
+void history_append(const struct Note *note);
+
+// Time the note is drawn until, including the sustain tail
+int note_visible_end(const struct Note *note);
+
+void history_copy_notes(int from_ms, int to_ms, struct HistoryNotes *out);
+// Finest level whose bins are at least min_bin_ms wide, else the coarsest
+int history_pick_level(int min_bin_ms);
+int history_level_bin_ms(int level);
+void history_copy_bins(int level, int from_ms, int to_ms, struct HistoryBins *out);
+int history_oldest_ms();
+size_t history_memory_bytes();
+
+#endif // SIGMIDI_HISTORY_H
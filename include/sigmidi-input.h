@@ -0,0 +1,56 @@
+#ifndef SIGMIDI_INPUT_H
+#define SIGMIDI_INPUT_H
+
+#include <poll.h>
+#include <sigmidi.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INPUT_BATCH_SIZE 256
+#define INPUT_MAX_POLL_FDS 4
+
+/*
+ * Source of struct MidiEvent for the core thread. The core thread polls the
+ * descriptors and then takes one batch from read_events() per loop, so a file
+ * that is always readable can't keep it from GC and publishing.
+ */
+struct InputBackend {
+    const char *name;
+    // Descriptors to wait on for input, returns how many were filled in
+    int (*poll_descriptors)(struct pollfd *fds, int max);
+    // Up to max pending events without blocking, 0 when there are none
+    int (*read_events)(struct MidiEvent *events, int max);
+    // Current time on the clock of MidiEvent.time
+    int (*now_ms)();
+    // Monotonic time at which that clock read 0
+    uint64_t (*epoch_ns)();
+    void (*close)();
+};
+
+// ALSA sequencer, see init_seqencer()
+extern const struct InputBackend alsa_input;
+
+// Raw MIDI bytes from a file, FIFO, raw MIDI device or "-" for stdin. Events
+// are stamped when parsed, the stream has no timestamps of its own
+const struct InputBackend *open_raw_input(const char *path);
+
+/*
+ * Raw MIDI byte stream parser. Handles running status, realtime bytes in the
+ * middle of other messages and skips SysEx.
+ */
+struct RawMidiParser {
+    uint8_t status;  // running status, 0 when none
+    uint8_t data[2]; // data bytes of the message being assembled
+    uint8_t have;    // data bytes collected so far
+    uint8_t in_sysex;
+};
+
+void rawmidi_parser_init(struct RawMidiParser *p);
+// Parse up to len bytes into at most max events, all stamped with time/ns.
+// Returns the number of events, *consumed is set to the bytes used, which is
+// less than len only when events filled up.
+int rawmidi_parse(struct RawMidiParser *p, const uint8_t *buf, size_t len,
+                  struct MidiEvent *events, int max, int time_ms, uint64_t time_ns,
+                  size_t *consumed);
+
+#endif // SIGMIDI_INPUT_H
@@ -0,0 +1,61 @@
+#ifndef SIGMIDI_LATENCY_H
+#define SIGMIDI_LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Log-linear histogram: 8 sub-buckets per power of two, so every bucket is
+ * within 12.5% of its value. Values above 2^40 ns (~18 min) are clamped.
+ */
+#define HIST_SUB_BITS 3
+#define HIST_MAX_MSB 40
+#define HIST_BUCKETS (((HIST_MAX_MSB - 1) << HIST_SUB_BITS) + (1 << HIST_SUB_BITS))
+
+struct Histogram {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+void hist_reset(struct Histogram *h);
+void hist_record(struct Histogram *h, uint64_t value);
+uint64_t hist_percentile(const struct Histogram *h, double p);
+
+/*
+ * Input-to-photon stages of a note:
+ *   queue wait: sequencer timestamp -> read_midi_events()
+ *   processing: read_midi_events() -> struct Note created
+ *   frame wait: struct Note created -> first frame latching a snapshot with it
+ *   present:    snapshot latched -> end_drawing() returns
+ *
+ * The snapshot is latched after begin_drawing(), as late as the frame allows,
+ * so a note created while the background was being queued still makes it and
+ * gets a frame wait of 0.
+ *
+ * The thru stage is not part of the note path, it covers event taken off the
+ * sequencer queue -> forwarded on the thru port. Time spent waiting in the
+ * queue before that shows up in the queue wait stage.
+ *
+ * The note stages are recorded by the render thread and the thru stage by the
+ * core thread. Reading another thread's histogram may see it mid-update, which
+ * is fine for display.
+ */
+enum LatencyStage {
+    LATENCY_QUEUE_WAIT,
+    LATENCY_PROCESSING,
+    LATENCY_FRAME_WAIT,
+    LATENCY_PRESENT,
+    LATENCY_TOTAL,
+    LATENCY_THRU,
+    LATENCY_STAGE_COUNT,
+};
+
+const char *latency_stage_name(enum LatencyStage stage);
+const struct Histogram *latency_hist(enum LatencyStage stage);
+void latency_record(enum LatencyStage stage, uint64_t ns);
+void latency_print_summary(FILE *out);
+
+#endif // SIGMIDI_LATENCY_H
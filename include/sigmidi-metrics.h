@@ -0,0 +1,78 @@
+#ifndef SIGMIDI_METRICS_H
+#define SIGMIDI_METRICS_H
+
+#include <sigmidi-seqlock.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Metrics published in a POSIX shared-memory segment for external monitoring.
+ * The segment holds a single struct MetricsShm guarded by a seqlock (see
+ * sigmidi-seqlock.h). Bump SIGMIDI_METRICS_VERSION whenever the layout
+ * changes.
+ */
+#define SIGMIDI_METRICS_SHM_NAME "/sigmidi-metrics"
+#define SIGMIDI_METRICS_MAGIC 0x4d4d4753 // "SGMM"
+#define SIGMIDI_METRICS_VERSION 1
+
+enum MetricsEventType {
+    METRICS_EVT_NOTEON,
+    METRICS_EVT_NOTEOFF,
+    METRICS_EVT_CONTROLLER,
+    METRICS_EVT_OTHER,
+    METRICS_EVT_COUNT,
+};
+
+struct MetricsShm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; // sizeof(struct MetricsShm) of the writer
+    uint32_t pid;
+    _Atomic uint32_t seq;
+    uint32_t target_fps;
+    uint64_t update_ns; // monotonic time of the last update
+
+    uint64_t events_total[METRICS_EVT_COUNT];
+    double events_per_sec[METRICS_EVT_COUNT];
+
+    uint32_t live_notes;
+    uint32_t note_queue_size;
+    uint32_t note_queue_capacity;
+    uint32_t event_queue_size; // peak between two snapshots, it is drained at once
+    uint32_t event_queue_capacity;
+    uint64_t pool_bytes; // notes, ring buffer and snapshot storage
+
+    uint64_t gc_runs;
+    uint64_t gc_pause_last_ns;
+    uint64_t gc_pause_max_ns;
+    uint64_t gc_pause_total_ns;
+
+    uint64_t frames_total;
+    uint64_t frames_dropped;
+    // Percentiles over the last completed METRICS_WINDOW_NS window
+    uint64_t frame_time_p50_ns;
+    uint64_t frame_time_p90_ns;
+    uint64_t frame_time_p99_ns;
+    uint64_t frame_time_max_ns;
+};
+
+// Copy a consistent snapshot out of the segment, false if the writer is stuck
+static inline bool metrics_shm_read(const struct MetricsShm *shm,
+                                    struct MetricsShm *out) {
+    return seqlock_read(&shm->seq, (const void *)shm, out, sizeof(*out));
+}
+
+// Writer side, implemented in sigmidi/metrics.c. Events and GC pauses are
+// counted on the core thread, frames are recorded and published on the render
+// thread.
+struct NoteSnapshot;
+
+void metrics_init(int target_fps);
+void metrics_close();
+void metrics_count_event(int snd_seq_event_type);
+void metrics_record_gc_pause(uint64_t ns);
+void metrics_record_frame(uint64_t present_ns);
+void metrics_publish(const struct NoteSnapshot *snapshot);
+
+#endif // SIGMIDI_METRICS_H
@@ -13,7 +13,9 @@ void begin_drawing();
 void end_drawing();
 void post_drawing();
 bool window_should_close();
-void draw_note(struct Note note);
+// False if the note is outside the view and nothing was drawn, only notes that
+// were drawn count as presented for the latency stats
+bool draw_note(struct Note note);
 // ... add more
 
 #endif // SIGMIDI_RENDERER_H
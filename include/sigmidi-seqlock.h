@@ -0,0 +1,50 @@
+#ifndef SIGMIDI_SEQLOCK_H
+#define SIGMIDI_SEQLOCK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Single writer seqlock. The writer makes `seq` odd while it updates the
+ * guarded data and even again when done, readers copy the data and retry
+ * until they see the same even `seq` before and after. The writer never
+ * waits; readers give up after SEQLOCK_READ_ATTEMPTS tries.
+ *
+ * Header-only so the monitoring tools can read shared memory with it.
+ */
+#define SEQLOCK_READ_ATTEMPTS 1000
+
+static inline void seqlock_write_begin(_Atomic uint32_t *seq) {
+    // Stays odd if a writer died mid-update, e.g. in a reused shm segment
+    uint32_t s = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, s | 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void seqlock_write_end(_Atomic uint32_t *seq) {
+    uint32_t s = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, s + 1, memory_order_release);
+}
+
+// Copy size bytes of data guarded by seq into out, false if the writer never
+// left them alone long enough
+static inline bool seqlock_read(const _Atomic uint32_t *seq, const void *data, void *out,
+                                size_t size) {
+    for (int attempt = 0; attempt < SEQLOCK_READ_ATTEMPTS; attempt++) {
+        uint32_t seq1 = atomic_load_explicit(seq, memory_order_acquire);
+        if (seq1 & 1)
+            continue;
+
+        __builtin_memcpy(out, data, size);
+
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t seq2 = atomic_load_explicit(seq, memory_order_relaxed);
+        if (seq1 == seq2)
+            return true;
+    }
+    return false;
+}
+
+#endif // SIGMIDI_SEQLOCK_H
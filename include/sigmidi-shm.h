@@ -0,0 +1,21 @@
+#ifndef SIGMIDI_SHM_H
+#define SIGMIDI_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Shared-memory segments with a single writer. The writer keeps an exclusive
+ * flock() on the segment for as long as it runs, so a second sigmidi can't
+ * take it over; the lock goes away with the process, so the segment left by
+ * one that crashed is simply reused.
+ */
+
+// Map `name` read-write, creating it if needed. NULL (and a warning naming
+// `what`) if another instance owns it or it can't be set up
+void *shm_writer_open(const char *name, size_t size, const char *what, int *fd);
+// Unmap and drop the lock, unlinks the segment if `unlink_segment` is set
+void shm_writer_close(const char *name, void *mem, size_t size, int fd,
+                      bool unlink_segment);
+
+#endif // SIGMIDI_SHM_H
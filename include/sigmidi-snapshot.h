@@ -0,0 +1,49 @@
+#ifndef SIGMIDI_SNAPSHOT_H
+#define SIGMIDI_SNAPSHOT_H
+
+#include <sigmidi.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Immutable copy of the visible notes, published by the core thread and drawn
+ * by the render thread. Notes are in note_queue order, i.e. ascending id.
+ */
+struct NoteSnapshot {
+    struct Note *notes;
+    int count;
+    int capacity;
+    uint64_t seq;          // publish counter, 0 until the first publish
+    uint64_t published_ns; // monotonic time of the publish
+
+    // Core state at publish time, for the HUD and metrics
+    int live_notes;
+    int note_queue_size;
+    int note_queue_capacity;
+    int event_queue_size; // peak since the previous snapshot
+    int event_queue_capacity;
+    uint64_t pool_bytes;
+};
+
+/*
+ * Lock-free triple buffer with one writer and one reader. The writer fills
+ * `back` and swaps it with `middle`, the reader swaps `front` with `middle`
+ * whenever the writer has published something newer. Neither side waits.
+ */
+struct SnapshotBuffer {
+    struct NoteSnapshot slots[3];
+    _Atomic int middle; // slot index, SNAPSHOT_DIRTY set when newer than front
+    int back;           // owned by the writer
+    int front;          // owned by the reader
+};
+
+void snapshot_buffer_init(struct SnapshotBuffer *sb);
+void snapshot_buffer_free(struct SnapshotBuffer *sb);
+// Writer: slot to fill, then hand it over with snapshot_publish()
+struct NoteSnapshot *snapshot_back(struct SnapshotBuffer *sb);
+void snapshot_reserve(struct NoteSnapshot *snapshot, int count);
+void snapshot_publish(struct SnapshotBuffer *sb);
+// Reader: newest complete snapshot, valid until the next call
+const struct NoteSnapshot *snapshot_acquire(struct SnapshotBuffer *sb);
+
+#endif // SIGMIDI_SNAPSHOT_H
@@ -0,0 +1,176 @@
+#ifndef SIGMIDI_STREAM_H
+#define SIGMIDI_STREAM_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Processed note stream published by sigmidi in a POSIX shared-memory ring.
+ * There is exactly one writer and any number of readers; the writer never
+ * waits for readers, a reader that falls more than SIGMIDI_STREAM_CAPACITY
+ * records behind loses the oldest ones and is told so.
+ *
+ * Record n lives in slot n % SIGMIDI_STREAM_CAPACITY. Its `seq` is 2n + 1
+ * while the writer fills it and 2n + 2 once complete, so readers can use
+ * records in place and validate them afterwards without copying.
+ *
+ * The segment outlives sigmidi and is reused by the next run, so attached
+ * readers follow a restart: the writer sets `generation` to 0 while it resets
+ * the ring and to a new value once done, readers seeing it change start over
+ * from record 0 of the new run.
+ *
+ * Readers are header-only, define SIGMIDI_STREAM_READER_IMPLEMENTATION in one
+ * translation unit before including this file.
+ */
+#define SIGMIDI_STREAM_SHM_NAME "/sigmidi-notes"
+#define SIGMIDI_STREAM_MAGIC 0x4e4d4753 // "SGMN"
+#define SIGMIDI_STREAM_VERSION 3
+#define SIGMIDI_STREAM_CAPACITY 4096 // must be a power of two
+
+enum NoteRecordType {
+    NOTE_RECORD_BEGIN,   // key pressed
+    NOTE_RECORD_END,     // key released or sustain cut by the pedal
+    NOTE_RECORD_SUSTAIN, // key released with the pedal down, rings for sus_duration
+};
+
+struct NoteRecord {
+    _Atomic uint64_t seq;
+    uint64_t id; // matches the begin record with its end/sustain records
+    int32_t time; // ms since NoteStreamShm.time_origin_ns
+    int32_t sus_duration;
+    uint8_t type;
+    uint8_t note;
+    uint8_t velocity;
+    uint8_t reserved[5];
+};
+
+struct NoteStreamShm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t pid;
+    uint32_t reserved;
+    // CLOCK_MONOTONIC time at which record time 0 was, so other processes can
+    // tell how old a record is: time_origin_ns + time * 1000000
+    uint64_t time_origin_ns;
+    _Atomic uint64_t generation; // changes every time sigmidi starts, 0 while it does
+    _Atomic uint64_t head;       // sequence number of the next record to be written
+    struct NoteRecord records[SIGMIDI_STREAM_CAPACITY];
+};
+
+// Writer side, implemented in sigmidi/stream.c
+struct Note;
+
+// time_origin_ns is the monotonic time at which the note times were 0
+void note_stream_init(uint64_t time_origin_ns);
+void note_stream_close();
+void note_stream_publish(enum NoteRecordType type, const struct Note *note, int time);
+
+// Reader side
+struct NoteStreamReader {
+    const struct NoteStreamShm *shm;
+    uint64_t generation; // of the run being followed
+    uint64_t next;       // sequence number of the next record to consume
+    uint64_t lost; // records overwritten before this reader got to them
+};
+
+// Attach to the stream, starting from the newest record. 0 on success, the
+// stream may belong to a sigmidi that has exited and will be followed once
+// another one starts.
+int note_stream_attach(struct NoteStreamReader *r);
+void note_stream_detach(struct NoteStreamReader *r);
+// Next unread record in place, NULL when caught up
+const struct NoteRecord *note_stream_peek(struct NoteStreamReader *r);
+// Release the record returned by note_stream_peek(), false if it was overwritten
+// while in use and its contents must be discarded
+bool note_stream_consume(struct NoteStreamReader *r);
+
+#endif // SIGMIDI_STREAM_H
+
+#ifdef SIGMIDI_STREAM_READER_IMPLEMENTATION
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define NOTE_STREAM_SLOT(shm, n) (&(shm)->records[(n) & (SIGMIDI_STREAM_CAPACITY - 1)])
+
+int note_stream_attach(struct NoteStreamReader *r) {
+    int fd = shm_open(SIGMIDI_STREAM_SHM_NAME, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+
+    const struct NoteStreamShm *shm =
+        mmap(NULL, sizeof(struct NoteStreamShm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED)
+        return -1;
+
+    if (shm->magic != SIGMIDI_STREAM_MAGIC || shm->version != SIGMIDI_STREAM_VERSION ||
+        shm->size != sizeof(struct NoteStreamShm)) {
+        munmap((void *)shm, sizeof(struct NoteStreamShm));
+        return -1;
+    }
+
+    r->shm = shm;
+    r->generation = atomic_load_explicit(&shm->generation, memory_order_acquire);
+    r->next = atomic_load_explicit(&shm->head, memory_order_acquire);
+    r->lost = 0;
+    return 0;
+}
+
+void note_stream_detach(struct NoteStreamReader *r) {
+    if (r->shm != NULL)
+        munmap((void *)r->shm, sizeof(struct NoteStreamShm));
+    r->shm = NULL;
+}
+
+const struct NoteRecord *note_stream_peek(struct NoteStreamReader *r) {
+    for (;;) {
+        uint64_t generation =
+            atomic_load_explicit(&r->shm->generation, memory_order_acquire);
+        if (generation != r->generation) {
+            if (generation == 0)
+                return NULL; // the writer is resetting the ring
+            // sigmidi restarted, follow the new run from its first record
+            r->generation = generation;
+            r->next = 0;
+        }
+
+        uint64_t head = atomic_load_explicit(&r->shm->head, memory_order_acquire);
+        // Behind us only while a restart is under way, the generation tells when done
+        if (head <= r->next)
+            return NULL;
+
+        if (head - r->next > SIGMIDI_STREAM_CAPACITY) {
+            r->lost += head - SIGMIDI_STREAM_CAPACITY - r->next;
+            r->next = head - SIGMIDI_STREAM_CAPACITY;
+        }
+
+        const struct NoteRecord *rec = NOTE_STREAM_SLOT(r->shm, r->next);
+        uint64_t seq = atomic_load_explicit(&rec->seq, memory_order_acquire);
+        if (seq == 2 * r->next + 2)
+            return rec;
+
+        // Lapped by the writer between reading head and the slot
+        r->lost++;
+        r->next++;
+    }
+}
+
+bool note_stream_consume(struct NoteStreamReader *r) {
+    const struct NoteRecord *rec = NOTE_STREAM_SLOT(r->shm, r->next);
+
+    atomic_thread_fence(memory_order_acquire);
+    bool intact =
+        atomic_load_explicit(&rec->seq, memory_order_relaxed) == 2 * r->next + 2;
+    if (!intact)
+        r->lost++;
+
+    r->next++;
+    return intact;
+}
+
+#endif // SIGMIDI_STREAM_READER_IMPLEMENTATION
@@ -0,0 +1,25 @@
+#ifndef SIGMIDI_TERM_H
+#define SIGMIDI_TERM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Extras of the terminal renderer (renderer/term-renderer.c, built with
+ * `make RENDERER=term`). Each cell shows two pixels with the upper half block,
+ * foreground for the top one and background for the bottom one.
+ */
+struct TermCell {
+    uint32_t fg; // 0xRRGGBB
+    uint32_t bg;
+    uint32_t ch; // code point
+};
+
+// Render into memory instead of the terminal, call before init_renderer()
+void term_use_memory_output(int cols, int rows);
+// Cells on screen after the last end_drawing()
+const struct TermCell *term_cells(int *cols, int *rows);
+// Escape sequences end_drawing() produced for the last frame
+const char *term_last_output(size_t *len);
+
+#endif // SIGMIDI_TERM_H
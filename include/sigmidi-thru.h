@@ -0,0 +1,26 @@
+#ifndef SIGMIDI_THRU_H
+#define SIGMIDI_THRU_H
+
+#include <alsa/asoundlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define THRU_ALL_CHANNELS 0xffff
+
+struct ThruOptions {
+    bool enabled;
+    uint16_t channel_mask; // bit n forwards MIDI channel n + 1
+    int transpose;         // semitones added to forwarded notes
+};
+
+// Create the "Thru Port" output port, does nothing unless options.enabled
+void init_thru_port(struct ThruOptions options);
+// Parse a comma separated list of 1-based channels into a channel mask
+int parse_thru_channels(const char *str, uint16_t *mask);
+// Parse a transpose in semitones, clamped to +-127. -1 if it isn't a number
+int parse_thru_transpose(const char *str, int *transpose);
+// Forward an incoming event to the subscribers of the thru port right away,
+// read_ns is when it was taken off the sequencer queue
+void thru_forward(const snd_seq_event_t *event, uint64_t read_ns);
+
+#endif // SIGMIDI_THRU_H
@@ -2,7 +2,10 @@
 #define SIGMIDI_H
 
 #include <alsa/asoundlib.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 
 #define LOG_INFO(fmt, ...) fprintf(stderr, "[INFO] " fmt "\n", ##__VA_ARGS__)
 #define LOG_WARN(fmt, ...) fprintf(stderr, "[WARN] " fmt "\n", ##__VA_ARGS__)
@@ -10,14 +13,30 @@
 
 extern snd_seq_t *handle;
 extern int local_port;
-extern bool sustain_pedal;
-extern bool sustain_pedal_enabled;
+// Shared between the core and render threads
+extern atomic_bool sustain_pedal;
+extern atomic_bool sustain_pedal_enabled;
 
+// Ended notes stay in the live snapshot this long before they move to the
+// history, which is also the height of the live view
+#define LIVE_WINDOW_MS 5000
+
+static inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// For controllers note/velocity hold param/value, for pitch bend and song
+// position the lsb/msb of the 14 bit value
 struct MidiEvent {
     snd_seq_event_type_t type;
+    unsigned char channel;
     unsigned char note;
     unsigned char velocity;
     int time;
+    uint64_t arrival_ns; // input timestamp on the monotonic clock
+    uint64_t read_ns;    // when the input backend handed it over
 };
 
 struct Note {
@@ -26,6 +45,12 @@ struct Note {
     int start;
     int end;
     int sus_duration;
+
+    // Latency bookkeeping, all on the monotonic clock
+    unsigned long id;
+    uint64_t arrival_ns;
+    uint64_t read_ns;
+    uint64_t processed_ns;
 };
 
 struct RendererOptions {
@@ -36,16 +61,43 @@ struct RendererOptions {
     int octave_count;
     int octave_offset;
     bool velocity_based_color;
+    // Lay notes out for the predicted present time instead of the frame start,
+    // only applies with late_latch since without vsync there is no present to
+    // predict
+    bool predict_present;
+    // Turn vsync on and start each frame as close to the next vsync as it can
+    // still make
+    bool late_latch;
 };
 
 struct AlsaClient {
     int id;
+    int port;
     char name[64];
 };
 
+// Cached sequencer topology, generation changes whenever the lists do
+struct Topology {
+    const struct AlsaClient *clients;
+    int client_count;
+    const struct AlsaClient *subs;
+    int sub_count;
+    unsigned long generation;
+};
+
+void init_topology();
+void free_topology();
+bool topology_handle_event(const snd_seq_event_t *event);
+void topology_lock();
+void topology_unlock();
+const struct Topology *get_topology();
 void list_seq_clients(struct AlsaClient *client_list, int size);
 void list_subscribed_seq_clients(struct AlsaClient *client_list, int size);
 void subscribe_to_a_sender(char *sender_str);
 void unsubscribe_to_a_sender(char *sender_str);
+// Queue a subscription change for the core thread, which owns the sequencer
+// handle. Safe to call from any thread
+void request_subscribe(const char *sender_str);
+void request_unsubscribe(const char *sender_str);
 
 #endif // SIGMIDI_H
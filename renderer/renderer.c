@@ -3,9 +3,21 @@
 #include <limits.h>
 #include <math.h>
 #include <raylib.h>
+#include <sigmidi-analytics.h>
+#include <sigmidi-clock.h>
+#include <sigmidi-history.h>
+#include <sigmidi-latency.h>
 #include <sigmidi-renderer.h>
+#include <stdlib.h>
 
 #define WHITE_PER_OCTAVE 7
+// Zoomed in further than this the history is drawn note by note
+#define DETAIL_MAX_HEIGHT_MS 20000
+// Frames taking longer than this (window drags, stalls) don't train the
+// present-time model
+#define MAX_PRESENT_LEAD_S 0.1
+// Extra headroom the late latch leaves before the vsync
+#define LATE_LATCH_SLACK_S 0.001
 
 const Color BG_COLOR = (Color){20, 20, 21, 255};
 const Color PIANO_ROLL_WHITE = (Color){195, 195, 213, 255};
@@ -38,13 +50,32 @@ struct Player {
     float bpm;
     int measure_len_ms;
     int measure_len_px;
+
+    // Time at the keyboard line, follows the clock unless paused
+    double view_time_ms;
+    bool paused;
+
+    // Grid locked to an incoming MIDI clock, bpm above is the fallback
+    bool synced;
+    double synced_bpm;
+    double synced_offset_ms; // from the keyboard line back to the last measure
 };
 
 static struct Layout layout;
 static struct Player player;
 static struct RendererOptions opt;
-static struct AlsaClient client_list[10];
-static struct AlsaClient sub_list[10];
+// Client lists formatted once per topology change
+static unsigned long topology_generation = ULONG_MAX;
+static char *client_list_text = NULL;
+static char *sub_list_text = NULL;
+
+// Frame pacing and present-time prediction, on the raylib clock in seconds
+static double frame_period_s;
+static double frame_start_s;      // when begin_drawing() sampled the time
+static double last_present_s;     // when EndDrawing() last returned
+static double present_lead_s;     // EWMA of frame start -> EndDrawing() return at vsync
+static double present_lead_dev_s; // EWMA of its absolute error
+static double frame_lead_s;       // lead the current frame is laid out with
 
 void calc_layout() {
     layout.octave_count = opt.octave_count;
@@ -65,11 +96,20 @@ int calc_measure_len() {
 
 void set_tempo(int t) {
     player.bpm = t;
+    // The manual grid is phased on the raylib clock, whose zero is this far
+    // into the monotonic one
+    analytics_set_manual_grid(t, monotonic_ns() - (uint64_t)(GetTime() * 1e9));
     player.beats_per_measure = 4;
     player.measure_len_ms = calc_measure_len();
     player.measure_len_px = player.measure_len_ms * player.px_per_ms;
 }
 
+void set_zoom(int height_ms) {
+    player.height_ms = height_ms;
+    player.px_per_ms = (double)player.height_px / player.height_ms;
+    set_tempo(player.bpm);
+}
+
 void resize_screen() {
     layout.white_width = GetScreenWidth() / layout.white_key_count;
     layout.white_height = GetScreenHeight() / 8;
@@ -90,13 +130,28 @@ void toggle_fullscreen() {
 void init_renderer(struct RendererOptions options) {
     opt = options;
 
-    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    unsigned int flags = FLAG_WINDOW_RESIZABLE;
+    if (opt.late_latch) {
+        flags |= FLAG_VSYNC_HINT;
+    }
+    SetConfigFlags(flags);
     InitWindow(opt.width, opt.height, opt.title);
-    SetTargetFPS(opt.fps);
+
+    frame_period_s = 1.0 / opt.fps;
+    if (opt.late_latch) {
+        // No SetTargetFPS(), pace_frame() waits before the frame instead of
+        // after the swap, so EndDrawing() returns at the vsync it presents on
+        int refresh = GetMonitorRefreshRate(GetCurrentMonitor());
+        if (refresh > 0)
+            frame_period_s = 1.0 / refresh;
+    } else {
+        SetTargetFPS(opt.fps);
+    }
+    last_present_s = frame_start_s = GetTime();
 
     calc_layout();
 
-    player.height_ms = 5000;
+    player.height_ms = LIVE_WINDOW_MS;
     player.height_px = layout.offset_y;
     player.px_per_ms = (double)player.height_px / player.height_ms;
 
@@ -113,27 +168,50 @@ void draw_octave_lines() {
     }
 }
 
+// Follow the MIDI clock at the time shown at the keyboard line
+void sync_measure_grid() {
+    struct ClockState clock;
+    double beat;
+
+    // Map the view time from the raylib clock onto the monotonic one
+    double behind_ms = GetTime() * 1000 - player.view_time_ms;
+    uint64_t view_ns = monotonic_ns() - (int64_t)(behind_ms * 1e6);
+
+    player.synced = clock_read(&clock) && clock_beat_at(&clock, view_ns, &beat);
+    if (!player.synced)
+        return;
+
+    double ms_per_beat = clock.period_ns * CLOCK_PPQN / 1e6;
+    player.synced_bpm = clock_bpm(&clock);
+    player.synced_offset_ms = fmod(beat, player.beats_per_measure) * ms_per_beat;
+    if (player.synced_offset_ms < 0)
+        player.synced_offset_ms += player.beats_per_measure * ms_per_beat;
+}
+
 void draw_measure_lines() {
+    double measure_len_ms = player.measure_len_ms;
+    double offset_ms = fmod(player.view_time_ms, player.measure_len_ms);
+    if (player.synced) {
+        measure_len_ms = player.beats_per_measure * 60000.0 / player.synced_bpm;
+        offset_ms = player.synced_offset_ms;
+    }
+
+    double measure_len_px = measure_len_ms * player.px_per_ms;
+    // Zoomed too far out for the lines to mean anything
+    if (measure_len_px < 4)
+        return;
+
     int x1 = 0;
     int x2 = GetScreenWidth();
-    float curr_time_ms = GetTime() * 1000;
-    float offset_ms = fmodf(curr_time_ms, player.measure_len_ms);
-    float offset_px = offset_ms * player.px_per_ms;
+    double offset_px = offset_ms * player.px_per_ms;
 
-    int n = player.height_ms / player.measure_len_ms;
+    int n = player.height_ms / measure_len_ms;
     for (int i = 0; i <= n; i++) {
-        int y = player.height_px - (i * player.measure_len_px) - offset_px;
+        int y = player.height_px - (i * measure_len_px) - offset_px;
         DrawLine(x1, y, x2, y, MEASURE_LINE_COLOR);
     }
 }
 
-void begin_drawing() {
-    BeginDrawing();
-    ClearBackground(BG_COLOR);
-    draw_measure_lines();
-    draw_octave_lines();
-}
-
 static bool is_black_key(unsigned char note) {
     static const bool black_lut[12] = {
         0, // C
@@ -170,6 +248,111 @@ static int get_prev_white_idx(unsigned char note) {
     return prev_white_idx_lut[note % 12];
 }
 
+// x and width of the column a note falls in, true for black keys
+static bool key_geometry(unsigned char note, int *x, int *w) {
+    int base_white_idx = note / 12 * WHITE_PER_OCTAVE;
+    base_white_idx -= opt.octave_offset * WHITE_PER_OCTAVE;
+    int prev_white_note = base_white_idx + get_prev_white_idx(note);
+
+    if (is_black_key(note)) {
+        *x = ((prev_white_note + 1) * layout.white_width) - (layout.black_width / 2);
+        *w = layout.black_width;
+        return true;
+    }
+    *x = (prev_white_note * layout.white_width);
+    *w = layout.white_width;
+    return false;
+}
+
+static void draw_history_bin(const struct HistoryBin *bin, int bin_ms) {
+    int x, w;
+    bool black = key_geometry(bin->key, &x, &w);
+    if (x + w < 0 || x > GetScreenWidth())
+        return;
+
+    double px = player.px_per_ms;
+    int y = player.height_px - (player.view_time_ms - bin->start_ms - bin_ms) * px;
+    int h = bin_ms * px + 1;
+    Color base = black ? FALLING_BLACK_NOTE_COLOR : FALLING_WHITE_NOTE_COLOR;
+    DrawRectangle(x, y, w, h, ColorAlpha(base, 0.15f + 0.85f * bin->occupancy));
+}
+
+// Notes that already left the live snapshot
+void draw_history() {
+    // Kept across frames so the copies don't allocate once grown
+    static struct HistoryNotes notes;
+    static struct HistoryBins bins;
+
+    if (!player.paused && player.height_ms <= LIVE_WINDOW_MS)
+        return;
+
+    int to_ms = player.view_time_ms;
+    int from_ms = to_ms - player.height_ms;
+
+    if (player.height_ms <= DETAIL_MAX_HEIGHT_MS) {
+        history_copy_notes(from_ms, to_ms, &notes);
+        for (int i = 0; i < notes.count; i++) {
+            draw_note(notes.items[i]);
+        }
+    } else {
+        // Bins of at least 2px, aggregated per key
+        int level = history_pick_level(2 / player.px_per_ms);
+        history_copy_bins(level, from_ms, to_ms, &bins);
+        for (int i = 0; i < bins.count; i++) {
+            draw_history_bin(&bins.items[i], bins.bin_ms);
+        }
+    }
+}
+
+// With late latching, wait until the frame can start as late as possible and
+// still make the next vsync, so the notes it shows are sampled just before
+// they go out. Otherwise raylib's frame limiter paces the frames.
+static void pace_frame() {
+    if (!opt.late_latch)
+        return;
+
+    double margin_s = present_lead_s + 2 * present_lead_dev_s + LATE_LATCH_SLACK_S;
+    double start = last_present_s + frame_period_s - margin_s;
+    double now = GetTime();
+    if (start > now) {
+        WaitTime(start - now);
+    }
+}
+
+// Only vsync makes EndDrawing() return at the present, without it the time up
+// to there is just the CPU side of the frame plus the limiter, nothing to
+// predict from
+static void update_present_model() {
+    last_present_s = GetTime();
+    if (!opt.late_latch)
+        return;
+
+    double lead_s = last_present_s - frame_start_s;
+    if (lead_s > MAX_PRESENT_LEAD_S)
+        return;
+
+    double error_s = lead_s - present_lead_s;
+    present_lead_s += error_s / 8;
+    present_lead_dev_s += (fabs(error_s) - present_lead_dev_s) / 8;
+}
+
+void begin_drawing() {
+    frame_start_s = GetTime();
+    frame_lead_s = opt.predict_present && opt.late_latch ? present_lead_s : 0;
+    if (!player.paused) {
+        // Where the keyboard line will be by the time the frame is on screen
+        player.view_time_ms = (frame_start_s + frame_lead_s) * 1000;
+    }
+
+    sync_measure_grid();
+
+    BeginDrawing();
+    ClearBackground(BG_COLOR);
+    draw_measure_lines();
+    draw_octave_lines();
+    draw_history();
+}
+
 static void draw_piano_roll() {
     int y = layout.offset_y;
 
@@ -208,39 +391,168 @@ static void draw_piano_roll() {
     }
 }
 
+static char *format_client_list(char *text, const struct AlsaClient *list, int count,
+                                bool with_port) {
+    size_t size = count * (sizeof(list->name) + 32) + 1;
+    text = realloc(text, size);
+    assert(text);
+
+    size_t len = 0;
+    text[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        if (with_port) {
+            len += snprintf(text + len, size - len, "%3d:%d %s\n", list[i].id,
+                            list[i].port, list[i].name);
+        } else {
+            len += snprintf(text + len, size - len, "%3d: %s\n", list[i].id,
+                            list[i].name);
+        }
+    }
+    return text;
+}
+
+static void update_topology_text() {
+    topology_lock();
+    const struct Topology *topology = get_topology();
+    if (topology->generation != topology_generation) {
+        client_list_text = format_client_list(client_list_text, topology->clients,
+                                              topology->client_count, false);
+        sub_list_text =
+            format_client_list(sub_list_text, topology->subs, topology->sub_count, true);
+        topology_generation = topology->generation;
+    }
+    topology_unlock();
+}
+
 void show_client_list() {
-    list_seq_clients(client_list, 10);
-    const char *lines[10];
-    for (int i = 0; i < 10; i++) {
-        if (strlen(client_list[i].name) == 0)
-            continue;
-        lines[i] = TextFormat("%3d: %s", client_list[i].id, client_list[i].name);
-    };
-    DrawText(TextJoin(lines, 10, "\n"), 0, 20, 20, TEXT_COLOR);
+    update_topology_text();
+    DrawText(client_list_text, 0, 20, 20, TEXT_COLOR);
 }
 
 void show_sub_list() {
-    list_subscribed_seq_clients(sub_list, 10);
-    const char *lines[10];
-    for (int i = 0; i < 10; i++) {
-        if (strlen(sub_list[i].name) == 0)
+    update_topology_text();
+    DrawText(sub_list_text, 0, 20, 20, TEXT_COLOR);
+}
+
+void show_latency_stats() {
+    // TextFormat() only rotates a handful of buffers, so format into our own
+    static char lines[LATENCY_STAGE_COUNT + 2][64];
+    const char *line_ptrs[LATENCY_STAGE_COUNT + 2];
+
+    snprintf(lines[0], sizeof(lines[0]), "latency ms: p50 / p90 / p99 / max");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const struct Histogram *h = latency_hist(i);
+        snprintf(lines[i + 1], sizeof(lines[i + 1]), "%s: %.2f / %.2f / %.2f / %.2f",
+                 latency_stage_name(i), hist_percentile(h, 50) / 1e6,
+                 hist_percentile(h, 90) / 1e6, hist_percentile(h, 99) / 1e6,
+                 h->max / 1e6);
+    }
+    if (opt.late_latch) {
+        snprintf(lines[LATENCY_STAGE_COUNT + 1], sizeof(lines[0]),
+                 "predicted vsync lead: %.2f +/- %.2f%s", present_lead_s * 1000,
+                 present_lead_dev_s * 1000, opt.predict_present ? "" : " (not applied)");
+    } else {
+        snprintf(lines[LATENCY_STAGE_COUNT + 1], sizeof(lines[0]),
+                 "no present prediction without vsync (-l)");
+    }
+    for (int i = 0; i < LATENCY_STAGE_COUNT + 2; i++) {
+        line_ptrs[i] = lines[i];
+    }
+    DrawText(TextJoin(line_ptrs, LATENCY_STAGE_COUNT + 2, "\n"), 0, 20, 20, TEXT_COLOR);
+}
+
+static void draw_velocity_hist(const struct AnalyticsHandStats *hand, int x, int y,
+                               int bar_w, int max_h) {
+    uint32_t max = 1;
+    for (int bin = 0; bin < ANALYTICS_VELOCITY_BINS; bin++) {
+        if (hand->velocity_hist[bin] > max)
+            max = hand->velocity_hist[bin];
+    }
+    for (int bin = 0; bin < ANALYTICS_VELOCITY_BINS; bin++) {
+        int h = (int64_t)hand->velocity_hist[bin] * max_h / max;
+        DrawRectangle(x + bin * bar_w, y + max_h - h, bar_w - 1, h, TEXT_COLOR);
+    }
+    DrawRectangleLines(x - 1, y - 1, ANALYTICS_VELOCITY_BINS * bar_w + 1, max_h + 2,
+                       MEASURE_LINE_COLOR);
+}
+
+void show_analytics() {
+    static const char *hand_names[ANALYTICS_HAND_COUNT] = {"left", "right"};
+    static char lines[6][96];
+    const char *line_ptrs[6];
+    struct AnalyticsSnapshot stats;
+
+    if (!analytics_read(&stats))
+        return;
+
+    snprintf(lines[0], sizeof(lines[0]), "last %.1f s: %u notes, %.1f notes/s",
+             stats.span_ms / 1000.0, stats.notes, stats.notes_per_sec);
+    snprintf(lines[1], sizeof(lines[1]), "chord density: %.2f notes/onset (%u onsets)",
+             stats.chord_density, stats.onsets);
+    for (int hand = 0; hand < ANALYTICS_HAND_COUNT; hand++) {
+        const struct AnalyticsHandStats *h = &stats.hands[hand];
+        snprintf(lines[2 + hand], sizeof(lines[0]),
+                 "%s: %u notes, velocity %.0f +/- %.0f, length %.0f ms", hand_names[hand],
+                 h->notes, h->velocity_mean, h->velocity_stddev, h->duration_mean_ms);
+    }
+    snprintf(lines[4], sizeof(lines[0]), "timing vs %s grid (1/%d): %+.1f ms mean",
+             stats.clock_grid ? "clock" : "tempo", ANALYTICS_GRID_DIVISION * 4,
+             stats.timing_mean_ms);
+    snprintf(lines[5], sizeof(lines[0]), "  %.1f ms mean abs, %.1f ms stddev",
+             stats.timing_abs_ms, stats.timing_stddev_ms);
+    for (int i = 0; i < 6; i++) {
+        line_ptrs[i] = lines[i];
+    }
+    DrawText(TextJoin(line_ptrs, 6, "\n"), 0, 20, 20, TEXT_COLOR);
+
+    // Velocity distribution per hand, below the text
+    for (int hand = 0; hand < ANALYTICS_HAND_COUNT; hand++) {
+        int x = 10 + hand * (ANALYTICS_VELOCITY_BINS * 8 + 40);
+        DrawText(hand_names[hand], x, 170, 20, TEXT_COLOR);
+        draw_velocity_hist(&stats.hands[hand], x, 195, 8, 60);
+    }
+
+    // Hits per key as bars standing on the keyboard
+    if (stats.max_key_hits == 0)
+        return;
+    int max_h = player.height_px / 4;
+    for (int key = 0; key < 128; key++) {
+        if (!stats.key_hits[key])
             continue;
-        lines[i] = TextFormat("%3d: %s", sub_list[i].id, sub_list[i].name);
-    };
-    DrawText(TextJoin(lines, 10, "\n"), 0, 20, 20, TEXT_COLOR);
+        int x, w;
+        key_geometry(key, &x, &w);
+        int h = (int64_t)stats.key_hits[key] * max_h / stats.max_key_hits;
+        DrawRectangle(x, player.height_px - h, w, h, ColorAlpha(TEXT_COLOR, 0.6f));
+    }
 }
 
 void end_drawing() {
     draw_piano_roll();
-    const char *status_str = TextFormat("Tempo: %d, Beats/Measure: %d", (int)player.bpm,
-                                        player.beats_per_measure);
+    const char *status_str;
+    const char *tempo_str = player.synced ? TextFormat("%.1f (clock)", player.synced_bpm)
+                                          : TextFormat("%d", (int)player.bpm);
+    if (player.paused) {
+        int behind_s = (GetTime() * 1000 - player.view_time_ms) / 1000;
+        status_str = TextFormat("Tempo: %s, Beats/Measure: %d, Paused -%d:%02d, "
+                                "View: %ds",
+                                tempo_str, player.beats_per_measure, behind_s / 60,
+                                behind_s % 60, player.height_ms / 1000);
+    } else {
+        status_str = TextFormat("Tempo: %s, Beats/Measure: %d, View: %ds", tempo_str,
+                                player.beats_per_measure, player.height_ms / 1000);
+    }
     DrawText(status_str, 0, 0, 20, TEXT_COLOR);
     if (IsKeyDown(KEY_L)) {
         show_client_list();
     } else if (IsKeyDown(KEY_S)) {
         show_sub_list();
+    } else if (IsKeyDown(KEY_H)) {
+        show_latency_stats();
+    } else if (IsKeyDown(KEY_A)) {
+        show_analytics();
     }
     EndDrawing();
+    update_present_model();
 }
 
 bool window_should_close() {
@@ -267,12 +579,16 @@ Color get_velocity_color_tanh(Color base_color, unsigned char velocity) {
     return ColorBrightness(base_color, y);
 }
 
-void draw_note(struct Note note) {
+bool draw_note(struct Note note) {
     int x, y, w, h, duration;
     Color color;
     // Calculate y and h
     // TODO: use the ALSA queue clock time
-    double curr_time = GetTime() * 1000;
+    double curr_time = player.view_time_ms;
+
+    // Outside the visible window, e.g. while paused or scrolled back
+    if (note.start > curr_time)
+        return false;
 
     duration = note.end - note.start;
     if (note.end == INT_MAX) {
@@ -281,26 +597,22 @@ void draw_note(struct Note note) {
         duration += note.sus_duration;
     }
 
+    if (note.start + duration < curr_time - player.height_ms)
+        return false;
+
     y = player.height_px - ((curr_time - note.start) * player.px_per_ms);
     h = duration * player.px_per_ms;
 
     // Calculate x and w
-    int base_white_idx = note.note / 12 * WHITE_PER_OCTAVE;
-    base_white_idx -= opt.octave_offset * WHITE_PER_OCTAVE;
-    int prev_white_note = base_white_idx + get_prev_white_idx(note.note);
-
-    if (is_black_key(note.note)) {
-        x = ((prev_white_note + 1) * layout.white_width) - (layout.black_width / 2);
-        w = layout.black_width;
+    if (key_geometry(note.note, &x, &w)) {
         color = get_velocity_color_tanh(FALLING_BLACK_NOTE_COLOR, note.velocity);
     } else {
-        x = (prev_white_note * layout.white_width);
-        w = layout.white_width;
         color = get_velocity_color_tanh(FALLING_WHITE_NOTE_COLOR, note.velocity);
     }
 
     DrawRectangle(x, y, w, h, color);
     DrawRectangleLines(x, y, w, h, BG_COLOR);
+    return true;
 }
 
 void update_octave_count(int new_count) {
@@ -308,15 +620,21 @@ void update_octave_count(int new_count) {
     calc_layout();
 }
 
+// Call with the topology locked
 bool is_subscribed(int client_id) {
-    for (int i = 0; *sub_list[i].name; i++) {
-        if (sub_list[i].id == client_id) {
+    const struct Topology *topology = get_topology();
+    for (int i = 0; i < topology->sub_count; i++) {
+        if (topology->subs[i].id == client_id) {
             return true;
         }
     }
     return false;
 }
 
+static void format_client_address(const struct AlsaClient *client, char buf[16]) {
+    snprintf(buf, 16, "%d:%d", client->id, client->port);
+}
+
 void pre_drawing() {
     if (IsWindowResized()) {
         resize_screen();
@@ -346,6 +664,33 @@ void pre_drawing() {
     if (IsKeyPressed(KEY_V)) {
         opt.velocity_based_color = !opt.velocity_based_color;
     }
+    // Scrollback
+    if (IsKeyPressed(KEY_SPACE)) {
+        player.paused = !player.paused;
+    }
+    if (IsKeyPressed(KEY_END)) {
+        player.paused = false;
+    }
+    if (IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_RIGHT)) {
+        double now_ms = GetTime() * 1000;
+        double step_ms = player.height_ms / 4.0;
+        player.paused = true;
+        player.view_time_ms += IsKeyPressed(KEY_LEFT) ? -step_ms : step_ms;
+
+        double oldest_ms = history_oldest_ms() + player.height_ms;
+        if (player.view_time_ms < oldest_ms)
+            player.view_time_ms = oldest_ms;
+        if (player.view_time_ms > now_ms)
+            player.view_time_ms = now_ms;
+    }
+    if (IsKeyPressed(KEY_LEFT_BRACKET) && player.height_ms < HISTORY_HORIZON_MS) {
+        int height_ms = player.height_ms * 2;
+        set_zoom(height_ms < HISTORY_HORIZON_MS ? height_ms : HISTORY_HORIZON_MS);
+    }
+    if (IsKeyPressed(KEY_RIGHT_BRACKET) && player.height_ms > LIVE_WINDOW_MS) {
+        int height_ms = player.height_ms / 2;
+        set_zoom(height_ms > LIVE_WINDOW_MS ? height_ms : LIVE_WINDOW_MS);
+    }
     if (IsKeyPressed(KEY_F)) {
         toggle_fullscreen();
     }
@@ -357,20 +702,39 @@ void pre_drawing() {
     }
     if (IsKeyDown(KEY_L)) {
         int client_idx = GetCharPressed() - '0' - 1;
-        if (client_idx >= 0 && client_idx <= 9) {
-            const struct AlsaClient client = client_list[client_idx];
-            if (!is_subscribed(client.id)) {
-                subscribe_to_a_sender((char *)client.name);
+        char addr[16] = {0};
+
+        topology_lock();
+        const struct Topology *topology = get_topology();
+        if (client_idx >= 0 && client_idx < topology->client_count) {
+            const struct AlsaClient *client = &topology->clients[client_idx];
+            if (!is_subscribed(client->id)) {
+                format_client_address(client, addr);
             }
         }
+        topology_unlock();
+
+        if (addr[0]) {
+            request_subscribe(addr);
+        }
     }
     if (IsKeyDown(KEY_S)) {
         int sub_idx = GetCharPressed() - '0' - 1;
-        if (sub_idx >= 0 && sub_idx <= 9) {
-            const struct AlsaClient client = sub_list[sub_idx];
-            unsubscribe_to_a_sender((char *)client.name);
+        char addr[16] = {0};
+
+        topology_lock();
+        const struct Topology *topology = get_topology();
+        if (sub_idx >= 0 && sub_idx < topology->sub_count) {
+            format_client_address(&topology->subs[sub_idx], addr);
+        }
+        topology_unlock();
+
+        if (addr[0]) {
+            request_unsubscribe(addr);
         }
     }
+
+    pace_frame();
 }
 
 void post_drawing() {
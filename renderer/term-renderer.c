@@ -0,0 +1,558 @@
+#include "sigmidi.h"
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
+#include <sigmidi-analytics.h>
+#include <sigmidi-clock.h>
+#include <sigmidi-renderer.h>
+#include <sigmidi-term.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define WHITE_PER_OCTAVE 7
+// Upper bound of the escape sequences for one cell: cursor move, two colors
+// and a 3 byte glyph
+#define MAX_CELL_BYTES 64
+#define HALF_BLOCK 0x2580
+
+#define RGB(r, g, b) ((uint32_t)(r) << 16 | (uint32_t)(g) << 8 | (uint32_t)(b))
+
+static const uint32_t BG_COLOR = RGB(20, 20, 21);
+static const uint32_t PIANO_ROLL_WHITE = RGB(195, 195, 213);
+static const uint32_t PIANO_ROLL_BLACK = RGB(0, 0, 0);
+static const uint32_t FALLING_WHITE_NOTE_COLOR = RGB(187, 157, 189);
+static const uint32_t FALLING_BLACK_NOTE_COLOR = RGB(216, 100, 126);
+static const uint32_t MEASURE_LINE_COLOR = RGB(75, 75, 76);
+static const uint32_t TEXT_COLOR = RGB(196, 130, 130);
+
+struct Layout {
+    int cols;
+    int rows;
+    int white_key_count;
+    double white_width; // in cells, keys are rounded to whole cells
+
+    // In pixels, two per cell vertically
+    int width;
+    int height;
+    int roll_top;
+    int roll_height;
+    int keyboard_top;
+    int keyboard_height;
+};
+
+struct Player {
+    double px_per_ms;
+    int beats_per_measure;
+    float bpm;
+    double view_time_ms;
+};
+
+static struct Layout layout;
+static struct Player player;
+static struct RendererOptions opt;
+
+static uint32_t *pixels;
+// front is what the terminal shows, back the frame being built
+static struct TermCell *front;
+static struct TermCell *back;
+// Color of the falling note over each key while it is held, 0 if none
+static uint32_t active_keys[128];
+
+static char *out;
+static size_t out_len;
+static size_t out_cap;
+
+static bool memory_output;
+static bool full_redraw;
+static bool keys_from_tty;
+static struct termios saved_termios;
+static uint64_t start_ns;
+static uint64_t next_frame_ns;
+
+static volatile sig_atomic_t quit_requested;
+static volatile sig_atomic_t resize_pending;
+
+static void on_signal(int sig) {
+    if (sig == SIGWINCH)
+        resize_pending = 1;
+    else
+        quit_requested = 1;
+}
+
+void term_use_memory_output(int cols, int rows) {
+    memory_output = true;
+    layout.cols = cols;
+    layout.rows = rows;
+}
+
+const struct TermCell *term_cells(int *cols, int *rows) {
+    *cols = layout.cols;
+    *rows = layout.rows;
+    return front;
+}
+
+const char *term_last_output(size_t *len) {
+    *len = out_len;
+    return out;
+}
+
+static void restore_terminal() {
+    if (memory_output)
+        return;
+
+    static const char leave[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+    if (write(STDOUT_FILENO, leave, sizeof(leave) - 1) < 0) {
+        // Nothing left to do about it on the way out
+    }
+    if (keys_from_tty)
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+}
+
+static void calc_layout() {
+    if (!memory_output) {
+        struct winsize ws;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 &&
+            ws.ws_row > 0) {
+            layout.cols = ws.ws_col;
+            layout.rows = ws.ws_row;
+        } else {
+            layout.cols = 80;
+            layout.rows = 24;
+        }
+    }
+    // Status line, at least one row of falling notes and the keyboard
+    if (layout.rows < 4)
+        layout.rows = 4;
+
+    layout.white_key_count = opt.octave_count * WHITE_PER_OCTAVE;
+    layout.white_width = (double)layout.cols / layout.white_key_count;
+
+    int keyboard_rows = layout.rows / 8 > 2 ? layout.rows / 8 : 2;
+    layout.width = layout.cols;
+    layout.height = layout.rows * 2;
+    layout.roll_top = 2;
+    layout.keyboard_height = keyboard_rows * 2;
+    layout.keyboard_top = layout.height - layout.keyboard_height;
+    layout.roll_height = layout.keyboard_top - layout.roll_top;
+
+    player.px_per_ms = (double)layout.roll_height / LIVE_WINDOW_MS;
+
+    size_t cells = (size_t)layout.cols * layout.rows;
+    pixels = realloc(pixels, (size_t)layout.width * layout.height * sizeof(uint32_t));
+    front = realloc(front, cells * sizeof(struct TermCell));
+    back = realloc(back, cells * sizeof(struct TermCell));
+    // Sized for a full redraw, so a frame never has to grow it
+    out_cap = cells * MAX_CELL_BYTES + 64;
+    out = realloc(out, out_cap);
+    assert(pixels && front && back && out);
+
+    full_redraw = true;
+}
+
+void init_renderer(struct RendererOptions options) {
+    opt = options;
+    player.bpm = 100;
+    player.beats_per_measure = 4;
+    start_ns = next_frame_ns = monotonic_ns();
+    analytics_set_manual_grid(player.bpm, start_ns);
+
+    if (!memory_output) {
+        signal(SIGINT, on_signal);
+        signal(SIGTERM, on_signal);
+        signal(SIGWINCH, on_signal);
+
+        // Raw input from stdin would share it with the keys
+        keys_from_tty = isatty(STDIN_FILENO);
+        if (keys_from_tty) {
+            tcgetattr(STDIN_FILENO, &saved_termios);
+            struct termios raw = saved_termios;
+            raw.c_lflag &= ~(ICANON | ECHO);
+            // read() returns right away, without making the shared tty nonblocking
+            raw.c_cc[VMIN] = 0;
+            raw.c_cc[VTIME] = 0;
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+        }
+
+        static const char enter[] = "\x1b[?1049h\x1b[?25l\x1b[2J";
+        if (write(STDOUT_FILENO, enter, sizeof(enter) - 1) < 0) {
+            LOG_ERROR("Failed to set up the terminal");
+            exit(EXIT_FAILURE);
+        }
+        atexit(restore_terminal);
+    }
+
+    calc_layout();
+}
+
+static inline void fill_rect(int x, int y, int w, int h, uint32_t color) {
+    int x2 = x + w < layout.width ? x + w : layout.width;
+    int y2 = y + h < layout.height ? y + h : layout.height;
+    if (x < 0)
+        x = 0;
+    if (y < 0)
+        y = 0;
+
+    for (int py = y; py < y2; py++) {
+        uint32_t *row = &pixels[(size_t)py * layout.width];
+        for (int px = x; px < x2; px++) {
+            row[px] = color;
+        }
+    }
+}
+
+static bool is_black_key(unsigned char note) {
+    static const bool black_lut[12] = {0, 1, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0};
+    return black_lut[note % 12];
+}
+
+static int get_prev_white_idx(unsigned char note) {
+    static const int prev_white_idx_lut[12] = {0, 0, 1, 1, 2, 3, 3, 4, 4, 5, 5, 6};
+    return prev_white_idx_lut[note % 12];
+}
+
+static int white_key_x(int white_idx) {
+    return (int)(white_idx * layout.white_width);
+}
+
+// x and width of the column a note falls in, true for black keys
+static bool key_geometry(unsigned char note, int *x, int *w) {
+    int base_white_idx = note / 12 * WHITE_PER_OCTAVE;
+    base_white_idx -= opt.octave_offset * WHITE_PER_OCTAVE;
+    int prev_white_note = base_white_idx + get_prev_white_idx(note);
+
+    if (is_black_key(note)) {
+        int black_w = layout.white_width / 2 > 1 ? layout.white_width / 2 : 1;
+        *x = white_key_x(prev_white_note + 1) - (black_w + 1) / 2;
+        *w = black_w;
+        return true;
+    }
+    *x = white_key_x(prev_white_note);
+    *w = white_key_x(prev_white_note + 1) - *x;
+    return false;
+}
+
+static uint32_t color_brightness(uint32_t color, float factor) {
+    uint32_t result = 0;
+    for (int shift = 16; shift >= 0; shift -= 8) {
+        float c = (color >> shift) & 0xff;
+        c = factor < 0 ? c * (1 + factor) : c + (255 - c) * factor;
+        result |= (uint32_t)c << shift;
+    }
+    return result;
+}
+
+// Same curve as the raylib renderer
+static uint32_t get_velocity_color_tanh(uint32_t base_color, unsigned char velocity) {
+    if (!opt.velocity_based_color)
+        return base_color;
+    float y = tanhf(8 * (velocity - 70.0f) / 127) * 0.4;
+    return color_brightness(base_color, y);
+}
+
+static void draw_measure_lines() {
+    double measure_len_ms = player.beats_per_measure * 60000.0 / player.bpm;
+    double offset_ms = fmod(player.view_time_ms, measure_len_ms);
+
+    struct ClockState clock;
+    double beat;
+    if (clock_read(&clock) && clock_beat_at(&clock, monotonic_ns(), &beat)) {
+        double ms_per_beat = clock.period_ns * CLOCK_PPQN / 1e6;
+        measure_len_ms = player.beats_per_measure * ms_per_beat;
+        offset_ms = fmod(beat, player.beats_per_measure) * ms_per_beat;
+        if (offset_ms < 0)
+            offset_ms += measure_len_ms;
+    }
+
+    double measure_len_px = measure_len_ms * player.px_per_ms;
+    if (measure_len_px < 2)
+        return;
+
+    int bottom = layout.roll_top + layout.roll_height;
+    for (double y = bottom - 1 - offset_ms * player.px_per_ms; y >= layout.roll_top;
+         y -= measure_len_px) {
+        fill_rect(0, (int)y, layout.width, 1, MEASURE_LINE_COLOR);
+    }
+}
+
+static void handle_keys() {
+    if (!keys_from_tty)
+        return;
+
+    char keys[64];
+    ssize_t n = read(STDIN_FILENO, keys, sizeof(keys));
+    for (ssize_t i = 0; i < n; i++) {
+        switch (keys[i]) {
+        case 'q':
+            quit_requested = 1;
+            break;
+        case '\x1b':
+            // Arrow keys arrive as ESC [ A/B, a lone ESC quits
+            if (i + 2 < n && keys[i + 1] == '[') {
+                if (keys[i + 2] == 'A' && opt.octave_count < 10)
+                    opt.octave_count++;
+                if (keys[i + 2] == 'B' && opt.octave_count > 1)
+                    opt.octave_count--;
+                calc_layout();
+                i += 2;
+            } else if (i + 1 == n) {
+                quit_requested = 1;
+            }
+            break;
+        case '+':
+            if (opt.octave_offset < 9)
+                opt.octave_offset++;
+            break;
+        case '-':
+            if (opt.octave_offset > -1)
+                opt.octave_offset--;
+            break;
+        case '<':
+            if (player.bpm > 10)
+                player.bpm -= 5;
+            analytics_set_manual_grid(player.bpm, start_ns);
+            break;
+        case '>':
+            if (player.bpm < 300)
+                player.bpm += 5;
+            analytics_set_manual_grid(player.bpm, start_ns);
+            break;
+        case 'v':
+            opt.velocity_based_color = !opt.velocity_based_color;
+            break;
+        case 'p':
+            sustain_pedal_enabled = !sustain_pedal_enabled;
+            if (sustain_pedal_enabled == false)
+                sustain_pedal = false;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void pre_drawing() {
+    if (resize_pending) {
+        resize_pending = 0;
+        calc_layout();
+    }
+    handle_keys();
+
+    // No vsync to wait for, sleep to the next frame slot
+    uint64_t period_ns = 1000000000ull / opt.fps;
+    uint64_t now = monotonic_ns();
+    if (next_frame_ns > now) {
+        struct timespec ts = {
+            .tv_sec = next_frame_ns / 1000000000ull,
+            .tv_nsec = next_frame_ns % 1000000000ull,
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    // After a stall start a fresh cadence instead of catching up
+    next_frame_ns = next_frame_ns + period_ns > now ? next_frame_ns + period_ns
+                                                    : now + period_ns;
+}
+
+void begin_drawing() {
+    player.view_time_ms = (monotonic_ns() - start_ns) / 1e6;
+
+    fill_rect(0, 0, layout.width, layout.height, BG_COLOR);
+    memset(active_keys, 0, sizeof(active_keys));
+    draw_measure_lines();
+}
+
+bool draw_note(struct Note note) {
+    int x, w, duration;
+    double curr_time = player.view_time_ms;
+
+    if (note.start > curr_time)
+        return false;
+
+    duration = note.end - note.start;
+    if (note.end == INT_MAX) {
+        duration = curr_time - note.start;
+    } else if (duration < note.sus_duration) {
+        duration += note.sus_duration;
+    }
+
+    if (note.start + duration < curr_time - LIVE_WINDOW_MS)
+        return false;
+
+    bool black = key_geometry(note.note, &x, &w);
+    uint32_t color = get_velocity_color_tanh(
+        black ? FALLING_BLACK_NOTE_COLOR : FALLING_WHITE_NOTE_COLOR, note.velocity);
+
+    // Notes rise from the keyboard, the start is the top edge
+    int bottom = layout.roll_top + layout.roll_height;
+    int y = bottom - (int)((curr_time - note.start) * player.px_per_ms);
+    int y_end = bottom - (int)((curr_time - note.start - duration) * player.px_per_ms);
+    if (y_end > bottom)
+        y_end = bottom;
+    // Leave a pixel between repeated notes on one key
+    if (y_end - y > 2)
+        y++;
+    if (y < layout.roll_top)
+        y = layout.roll_top;
+    fill_rect(x, y, w, y_end > y ? y_end - y : 1, color);
+
+    if (note.end == INT_MAX && note.note < 128)
+        active_keys[note.note] = color;
+    return true;
+}
+
+static void draw_keyboard() {
+    int y = layout.keyboard_top;
+    int h = layout.keyboard_height;
+    static const int white_notes[WHITE_PER_OCTAVE] = {0, 2, 4, 5, 7, 9, 11};
+    int first_note = opt.octave_offset * 12;
+
+    for (int i = 0; i < layout.white_key_count; i++) {
+        int x = white_key_x(i);
+        int w = white_key_x(i + 1) - x;
+        int note =
+            first_note + i / WHITE_PER_OCTAVE * 12 + white_notes[i % WHITE_PER_OCTAVE];
+        uint32_t color = note >= 0 && note < 128 && active_keys[note] ? active_keys[note]
+                                                                       : PIANO_ROLL_WHITE;
+        fill_rect(x, y, w, h, color);
+        // Gap between white keys once they are wide enough for one
+        if (w >= 3)
+            fill_rect(x + w - 1, y, 1, h, BG_COLOR);
+    }
+
+    for (int note = first_note; note < first_note + opt.octave_count * 12; note++) {
+        if (note < 0 || note >= 128 || !is_black_key(note))
+            continue;
+        int x, w;
+        key_geometry(note, &x, &w);
+        fill_rect(x, y, w, h * 2 / 3,
+                  active_keys[note] ? active_keys[note] : PIANO_ROLL_BLACK);
+    }
+}
+
+static void draw_status_line() {
+    char status[128];
+    struct ClockState clock;
+    if (clock_read(&clock) && clock.running && clock.locked) {
+        snprintf(status, sizeof(status), " Tempo: %.1f (clock), Beats/Measure: %d",
+                 clock_bpm(&clock), player.beats_per_measure);
+    } else {
+        snprintf(status, sizeof(status), " Tempo: %d, Beats/Measure: %d", (int)player.bpm,
+                 player.beats_per_measure);
+    }
+
+    for (int i = 0; status[i] && i < layout.cols; i++) {
+        back[i] = (struct TermCell){.fg = TEXT_COLOR, .bg = BG_COLOR, .ch = status[i]};
+    }
+}
+
+static void pixels_to_cells() {
+    for (int row = 0; row < layout.rows; row++) {
+        const uint32_t *top = &pixels[(size_t)row * 2 * layout.width];
+        const uint32_t *bottom = top + layout.width;
+        struct TermCell *cells = &back[(size_t)row * layout.cols];
+
+        for (int col = 0; col < layout.cols; col++) {
+            if (top[col] == bottom[col]) {
+                // A blank only needs its background
+                cells[col] = (struct TermCell){.fg = top[col], .bg = top[col], .ch = ' '};
+            } else {
+                cells[col] = (struct TermCell){
+                    .fg = top[col], .bg = bottom[col], .ch = HALF_BLOCK};
+            }
+        }
+    }
+}
+
+static inline void put_color(const char *prefix, uint32_t color) {
+    out_len += sprintf(out + out_len, "\x1b[%s;2;%u;%u;%um", prefix, color >> 16,
+                       (color >> 8) & 0xff, color & 0xff);
+}
+
+static inline void put_glyph(uint32_t ch) {
+    if (ch < 0x80) {
+        out[out_len++] = ch;
+    } else {
+        out[out_len++] = 0xe0 | (ch >> 12);
+        out[out_len++] = 0x80 | ((ch >> 6) & 0x3f);
+        out[out_len++] = 0x80 | (ch & 0x3f);
+    }
+}
+
+static inline bool same_cell(const struct TermCell *a, const struct TermCell *b) {
+    return a->ch == b->ch && a->bg == b->bg && (a->ch == ' ' || a->fg == b->fg);
+}
+
+// Escape sequences for the cells that changed since the last frame
+static void encode_damage() {
+    int cursor_row = -1, cursor_col = -1;
+    uint32_t fg = UINT32_MAX, bg = UINT32_MAX;
+
+    out_len = 0;
+    if (full_redraw)
+        out_len += sprintf(out, "\x1b[2J");
+
+    for (int row = 0; row < layout.rows; row++) {
+        for (int col = 0; col < layout.cols; col++) {
+            size_t i = (size_t)row * layout.cols + col;
+            if (!full_redraw && same_cell(&back[i], &front[i]))
+                continue;
+
+            if (row != cursor_row || col != cursor_col)
+                out_len += sprintf(out + out_len, "\x1b[%d;%dH", row + 1, col + 1);
+            if (back[i].ch != ' ' && back[i].fg != fg) {
+                put_color("38", back[i].fg);
+                fg = back[i].fg;
+            }
+            if (back[i].bg != bg) {
+                put_color("48", back[i].bg);
+                bg = back[i].bg;
+            }
+            put_glyph(back[i].ch);
+
+            cursor_row = row;
+            cursor_col = col + 1;
+        }
+    }
+    full_redraw = false;
+}
+
+static void flush_output() {
+    size_t done = 0;
+    while (done < out_len) {
+        ssize_t n = write(STDOUT_FILENO, out + done, out_len - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("Failed to write to the terminal");
+            quit_requested = 1;
+            return;
+        }
+        done += n;
+    }
+}
+
+void end_drawing() {
+    draw_keyboard();
+    pixels_to_cells();
+    draw_status_line();
+    encode_damage();
+
+    // One write per frame
+    if (!memory_output && out_len > 0)
+        flush_output();
+
+    struct TermCell *tmp = front;
+    front = back;
+    back = tmp;
+}
+
+void post_drawing() {
+}
+
+bool window_should_close() {
+    return quit_requested;
+}
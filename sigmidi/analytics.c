@@ -0,0 +1,243 @@
+#include <math.h>
+#include <sigmidi-analytics.h>
+#include <sigmidi-clock.h>
+#include <sigmidi-seqlock.h>
+#include <string.h>
+
+#define BUCKET_COUNT (ANALYTICS_WINDOW_MS / ANALYTICS_BUCKET_MS)
+#define VELOCITY_BIN_WIDTH (128 / ANALYTICS_VELOCITY_BINS)
+
+struct Bucket {
+    uint32_t notes;
+    uint32_t onsets;
+    uint16_t key_hits[128];
+
+    uint32_t hand_notes[ANALYTICS_HAND_COUNT];
+    uint64_t velocity_sum[ANALYTICS_HAND_COUNT];
+    uint64_t velocity_sq_sum[ANALYTICS_HAND_COUNT];
+    uint32_t velocity_hist[ANALYTICS_HAND_COUNT][ANALYTICS_VELOCITY_BINS];
+    uint32_t released[ANALYTICS_HAND_COUNT];
+    uint64_t duration_sum_ms[ANALYTICS_HAND_COUNT];
+
+    // Deviation from the grid in microseconds
+    uint32_t timed;
+    int64_t deviation_sum;
+    uint64_t deviation_abs_sum;
+    uint64_t deviation_sq_sum;
+    uint32_t clock_timed; // of timed, measured against the MIDI clock
+};
+
+// Core thread only
+static struct Bucket buckets[BUCKET_COUNT];
+static struct Bucket window; // sum of all buckets
+static int newest_bucket = -1; // absolute index, time / ANALYTICS_BUCKET_MS
+static int first_ms = -1;
+static int last_onset_ms = -ANALYTICS_CHORD_MS - 1;
+static bool dirty;
+
+// Written by the core thread, read by any
+static struct {
+    _Atomic uint32_t seq;
+    struct AnalyticsSnapshot snapshot;
+} shared;
+
+// Set by the renderer, a note timed during a tempo change may pair the old
+// origin with the new tempo, which only costs that one note
+static _Atomic double manual_bpm = 100;
+static _Atomic uint64_t manual_origin_ns;
+
+static void bucket_add(struct Bucket *dst, const struct Bucket *src, int sign) {
+    dst->notes += sign * src->notes;
+    dst->onsets += sign * src->onsets;
+    for (int key = 0; key < 128; key++) {
+        dst->key_hits[key] += sign * src->key_hits[key];
+    }
+    for (int hand = 0; hand < ANALYTICS_HAND_COUNT; hand++) {
+        dst->hand_notes[hand] += sign * src->hand_notes[hand];
+        dst->velocity_sum[hand] += sign * src->velocity_sum[hand];
+        dst->velocity_sq_sum[hand] += sign * src->velocity_sq_sum[hand];
+        for (int bin = 0; bin < ANALYTICS_VELOCITY_BINS; bin++) {
+            dst->velocity_hist[hand][bin] += sign * src->velocity_hist[hand][bin];
+        }
+        dst->released[hand] += sign * src->released[hand];
+        dst->duration_sum_ms[hand] += sign * src->duration_sum_ms[hand];
+    }
+    dst->timed += sign * src->timed;
+    dst->deviation_sum += sign * src->deviation_sum;
+    dst->deviation_abs_sum += sign * src->deviation_abs_sum;
+    dst->deviation_sq_sum += sign * src->deviation_sq_sum;
+    dst->clock_timed += sign * src->clock_timed;
+}
+
+// Slide the window so it ends at time_ms, returns the bucket to add to
+static struct Bucket *advance_to(int time_ms) {
+    int idx = time_ms / ANALYTICS_BUCKET_MS;
+    if (first_ms < 0) {
+        first_ms = time_ms;
+        newest_bucket = idx;
+    }
+    // Late events land in the newest bucket
+    if (idx <= newest_bucket)
+        return &buckets[newest_bucket % BUCKET_COUNT];
+
+    // Past a full window every bucket goes, no need to walk the gap
+    if (idx - newest_bucket >= BUCKET_COUNT) {
+        memset(buckets, 0, sizeof(buckets));
+        memset(&window, 0, sizeof(window));
+    } else {
+        for (int b = newest_bucket + 1; b <= idx; b++) {
+            struct Bucket *expired = &buckets[b % BUCKET_COUNT];
+            bucket_add(&window, expired, -1);
+            memset(expired, 0, sizeof(*expired));
+        }
+    }
+    newest_bucket = idx;
+    dirty = true;
+    return &buckets[idx % BUCKET_COUNT];
+}
+
+static inline enum AnalyticsHand hand_of(unsigned char note) {
+    return note < ANALYTICS_HAND_SPLIT ? ANALYTICS_LEFT : ANALYTICS_RIGHT;
+}
+
+// Distance to the nearest grid line in ms, false if there is no grid
+static bool grid_deviation(const struct Note *note, double *deviation_ms,
+                           bool *clock_grid) {
+    struct ClockState clock;
+    double beat, beat_ms;
+
+    *clock_grid = clock_read(&clock) && clock_beat_at(&clock, note->arrival_ns, &beat);
+    if (*clock_grid) {
+        beat_ms = clock.period_ns * CLOCK_PPQN / 1e6;
+    } else {
+        double bpm = atomic_load_explicit(&manual_bpm, memory_order_relaxed);
+        uint64_t origin_ns =
+            atomic_load_explicit(&manual_origin_ns, memory_order_relaxed);
+        if (bpm <= 0)
+            return false;
+        beat_ms = 60000.0 / bpm;
+        // Same clock and phase as the drawn grid, not the sequencer queue time
+        beat = (int64_t)(note->arrival_ns - origin_ns) / 1e6 / beat_ms;
+    }
+
+    double pos = beat * ANALYTICS_GRID_DIVISION;
+    *deviation_ms = (pos - round(pos)) * beat_ms / ANALYTICS_GRID_DIVISION;
+    return true;
+}
+
+void analytics_note_on(const struct Note *note) {
+    enum AnalyticsHand hand = hand_of(note->note);
+    bool onset = note->start - last_onset_ms > ANALYTICS_CHORD_MS;
+    if (onset)
+        last_onset_ms = note->start;
+
+    double deviation_ms = 0;
+    bool clock_grid;
+    bool timed = grid_deviation(note, &deviation_ms, &clock_grid);
+    int64_t us = llround(deviation_ms * 1000);
+
+    // Same increments for the newest bucket and the running totals
+    struct Bucket *targets[2] = {advance_to(note->start), &window};
+    for (int i = 0; i < 2; i++) {
+        struct Bucket *b = targets[i];
+        b->notes++;
+        b->onsets += onset;
+        b->key_hits[note->note & 127]++;
+        b->hand_notes[hand]++;
+        b->velocity_sum[hand] += note->velocity;
+        b->velocity_sq_sum[hand] += note->velocity * note->velocity;
+        b->velocity_hist[hand][(note->velocity & 127) / VELOCITY_BIN_WIDTH]++;
+        if (timed) {
+            b->timed++;
+            b->deviation_sum += us;
+            b->deviation_abs_sum += us < 0 ? -us : us;
+            b->deviation_sq_sum += us * us;
+            b->clock_timed += clock_grid;
+        }
+    }
+    dirty = true;
+}
+
+void analytics_note_off(const struct Note *note) {
+    enum AnalyticsHand hand = hand_of(note->note);
+    int duration = note->end > note->start ? note->end - note->start : 0;
+
+    struct Bucket *targets[2] = {advance_to(note->end), &window};
+    for (int i = 0; i < 2; i++) {
+        targets[i]->released[hand]++;
+        targets[i]->duration_sum_ms[hand] += duration;
+    }
+    dirty = true;
+}
+
+static double stddev(double sum, double sq_sum, double n) {
+    if (n < 2)
+        return 0;
+    double mean = sum / n;
+    double variance = sq_sum / n - mean * mean;
+    return variance > 0 ? sqrt(variance) : 0;
+}
+
+static void publish(int now_ms) {
+    seqlock_write_begin(&shared.seq);
+
+    struct AnalyticsSnapshot *s = &shared.snapshot;
+    int span = now_ms - first_ms;
+    s->span_ms = span < ANALYTICS_WINDOW_MS ? (span > 0 ? span : 0) : ANALYTICS_WINDOW_MS;
+    s->notes = window.notes;
+    s->notes_per_sec = s->span_ms > 0 ? window.notes * 1000.0 / s->span_ms : 0;
+
+    s->max_key_hits = 0;
+    for (int key = 0; key < 128; key++) {
+        s->key_hits[key] = window.key_hits[key];
+        if (window.key_hits[key] > s->max_key_hits)
+            s->max_key_hits = window.key_hits[key];
+    }
+
+    for (int hand = 0; hand < ANALYTICS_HAND_COUNT; hand++) {
+        struct AnalyticsHandStats *h = &s->hands[hand];
+        double n = window.hand_notes[hand];
+        h->notes = window.hand_notes[hand];
+        h->velocity_mean = n > 0 ? window.velocity_sum[hand] / n : 0;
+        h->velocity_stddev =
+            stddev(window.velocity_sum[hand], window.velocity_sq_sum[hand], n);
+        memcpy(h->velocity_hist, window.velocity_hist[hand], sizeof(h->velocity_hist));
+        h->duration_mean_ms =
+            window.released[hand] > 0
+                ? (double)window.duration_sum_ms[hand] / window.released[hand]
+                : 0;
+    }
+
+    s->onsets = window.onsets;
+    s->chord_density = window.onsets > 0 ? (double)window.notes / window.onsets : 0;
+
+    double timed = window.timed;
+    s->clock_grid = window.timed > 0 && window.clock_timed * 2 > window.timed;
+    s->timed_notes = window.timed;
+    s->timing_mean_ms = timed > 0 ? window.deviation_sum / timed / 1000 : 0;
+    s->timing_abs_ms = timed > 0 ? window.deviation_abs_sum / timed / 1000 : 0;
+    s->timing_stddev_ms =
+        stddev(window.deviation_sum, window.deviation_sq_sum, timed) / 1000;
+
+    seqlock_write_end(&shared.seq);
+}
+
+void analytics_tick(int now_ms) {
+    if (first_ms < 0)
+        return;
+
+    advance_to(now_ms);
+    if (dirty) {
+        publish(now_ms);
+        dirty = false;
+    }
+}
+
+void analytics_set_manual_grid(double bpm, uint64_t origin_ns) {
+    atomic_store_explicit(&manual_origin_ns, origin_ns, memory_order_relaxed);
+    atomic_store_explicit(&manual_bpm, bpm, memory_order_relaxed);
+}
+
+bool analytics_read(struct AnalyticsSnapshot *out) {
+    return seqlock_read(&shared.seq, &shared.snapshot, out, sizeof(*out));
+}
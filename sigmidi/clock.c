@@ -0,0 +1,163 @@
+#include <math.h>
+#include <sigmidi-clock.h>
+#include <sigmidi-seqlock.h>
+#include <stdatomic.h>
+
+// Loop bandwidth while acquiring and once locked, in Hz
+#define ACQUIRE_BANDWIDTH_HZ 2.0
+#define TRACK_BANDWIDTH_HZ 0.5
+// Ticks filtered with the acquire bandwidth before switching over
+#define ACQUIRE_TICKS (2 * CLOCK_PPQN)
+// Above this the loop gain gets too close to instability at slow tempos
+#define MAX_OMEGA 0.5
+// Consecutive ticks outside half a period that restart the lock
+#define MAX_OUTLIERS 3
+// Longest run of dropped ticks that is bridged instead of relocking
+#define MAX_MISSED_TICKS 4
+
+// Core thread only
+static struct {
+    bool running;
+    uint64_t next_tick; // song position the next tick lands on
+    int ticks_seen;     // since the lock was (re)started
+    int outliers;
+    uint64_t tick;
+    double t0; // filtered time of the last tick
+    double t1; // predicted time of the next tick
+    double e2; // filtered period
+    double jitter;
+    uint64_t last_arrival_ns;
+} pll;
+
+// Written by the core thread, read by the renderer
+static struct {
+    _Atomic uint32_t seq;
+    struct ClockState state;
+} shared;
+
+static void publish() {
+    seqlock_write_begin(&shared.seq);
+
+    shared.state.running = pll.running;
+    shared.state.locked = pll.ticks_seen > CLOCK_PPQN;
+    shared.state.tick = pll.tick;
+    shared.state.tick_ns = pll.t0;
+    shared.state.period_ns = pll.e2;
+    shared.state.jitter_ns = pll.jitter;
+    shared.state.last_arrival_ns = pll.last_arrival_ns;
+
+    seqlock_write_end(&shared.seq);
+}
+
+static void handle_tick(uint64_t arrival_ns) {
+    double t = arrival_ns;
+    pll.last_arrival_ns = arrival_ns;
+
+    // Position only moves while the transport runs
+    pll.tick = pll.next_tick;
+    if (pll.running)
+        pll.next_tick++;
+
+    if (pll.ticks_seen == 0) {
+        pll.t0 = t;
+        pll.ticks_seen = 1;
+        return;
+    }
+    if (pll.ticks_seen == 1) {
+        pll.e2 = t - pll.t0;
+        pll.t0 = t;
+        pll.t1 = t + pll.e2;
+        pll.jitter = 0;
+        pll.outliers = 0;
+        pll.ticks_seen = 2;
+        return;
+    }
+
+    double e = t - pll.t1;
+    if (fabs(e) > pll.e2 / 2) {
+        long missed = lround(e / pll.e2);
+        double residual = e - missed * pll.e2;
+        if (missed >= 1 && missed <= MAX_MISSED_TICKS && fabs(residual) < pll.e2 / 4) {
+            // Dropped ticks, catch the prediction and the position up
+            pll.t1 += missed * pll.e2;
+            if (pll.running) {
+                pll.tick += missed;
+                pll.next_tick += missed;
+            }
+            e = residual;
+        } else if (++pll.outliers > MAX_OUTLIERS) {
+            // Tempo jump or the sender restarted, lock again from here
+            pll.t0 = t;
+            pll.ticks_seen = 1;
+            return;
+        } else {
+            // A single late or early tick, don't let it drag the loop
+            e = e > 0 ? pll.e2 / 4 : -pll.e2 / 4;
+        }
+    } else {
+        pll.outliers = 0;
+    }
+
+    double bandwidth =
+        pll.ticks_seen < ACQUIRE_TICKS ? ACQUIRE_BANDWIDTH_HZ : TRACK_BANDWIDTH_HZ;
+    double omega = 2 * M_PI * bandwidth * pll.e2 / 1e9;
+    if (omega > MAX_OMEGA)
+        omega = MAX_OMEGA;
+
+    pll.t0 = pll.t1;
+    pll.t1 += M_SQRT2 * omega * e + pll.e2;
+    pll.e2 += omega * omega * e;
+    pll.jitter += (fabs(e) - pll.jitter) / 16;
+    pll.ticks_seen++;
+}
+
+void clock_handle_event(const struct MidiEvent *event) {
+    switch (event->type) {
+    case SND_SEQ_EVENT_CLOCK:
+        handle_tick(event->arrival_ns);
+        break;
+    case SND_SEQ_EVENT_START:
+        pll.running = true;
+        pll.next_tick = 0;
+        break;
+    case SND_SEQ_EVENT_CONTINUE:
+        pll.running = true;
+        break;
+    case SND_SEQ_EVENT_STOP:
+        pll.running = false;
+        break;
+    case SND_SEQ_EVENT_SONGPOS:
+        // Song position counts sixteenth notes, 6 clocks each
+        pll.next_tick = (event->note | event->velocity << 7) * 6;
+        break;
+    default:
+        return;
+    }
+    publish();
+}
+
+bool clock_read(struct ClockState *out) {
+    if (!seqlock_read(&shared.seq, &shared.state, out, sizeof(*out)))
+        return false;
+
+    // The writer only runs on ticks, so notice a silent sender here
+    uint64_t now = monotonic_ns();
+    if (now > out->last_arrival_ns + CLOCK_LOST_TICKS * out->period_ns)
+        out->locked = false;
+    return true;
+}
+
+bool clock_beat_at(const struct ClockState *state, uint64_t ns, double *beat) {
+    if (!state->running || !state->locked || state->period_ns <= 0)
+        return false;
+
+    double ticks = ((double)ns - state->tick_ns) / state->period_ns;
+    *beat = (state->tick + ticks) / CLOCK_PPQN;
+    return true;
+}
+
+double clock_bpm(const struct ClockState *state) {
+    if (state->period_ns <= 0)
+        return 0;
+    return 60e9 / (state->period_ns * CLOCK_PPQN);
+}
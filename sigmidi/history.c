@@ -0,0 +1,305 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sigmidi-history.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Upper bound of an encoded note: 3 varints of up to 5 bytes plus 2 bytes
+#define MAX_RECORD_SIZE 17
+#define MAX_BLOCKS (HISTORY_MAX_BLOCK_BYTES / HISTORY_BLOCK_SIZE)
+
+struct HistoryBlock {
+    int first_start;
+    int last_start; // start of the last record, base of the next delta
+    int max_end;    // latest visible end of any note in the block
+    int count;
+    int used;
+    unsigned char data[HISTORY_BLOCK_SIZE];
+};
+
+struct DensityLevel {
+    int bin_ms;
+    int bin_count;
+    int *bin_index;        // absolute bin held by each slot, -1 when empty
+    uint16_t *sounding_ms; // [slot * HISTORY_KEYS + key]
+};
+
+static const int level_bin_ms[HISTORY_LEVEL_COUNT] = {100, 1000, 10000};
+
+// Circular array of blocks, oldest at `first`
+static struct HistoryBlock *blocks[MAX_BLOCKS];
+static int first_block;
+static int block_count;
+static struct DensityLevel levels[HISTORY_LEVEL_COUNT];
+static int newest_end;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline struct HistoryBlock *block_at(int i) {
+    return blocks[(first_block + i) % MAX_BLOCKS];
+}
+
+static inline unsigned char *put_varint(unsigned char *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = v | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static inline const unsigned char *get_varint(const unsigned char *p, uint32_t *v) {
+    uint32_t result = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        result |= (uint32_t)(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    *v = result | (uint32_t)*p++ << shift;
+    return p;
+}
+
+static inline uint32_t zigzag(int v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int unzigzag(uint32_t v) {
+    return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+int note_visible_end(const struct Note *note) {
+    // Same rule draw_note() uses for the sustain tail
+    int duration = note->end - note->start;
+    if (duration < note->sus_duration)
+        duration += note->sus_duration;
+    return note->start + duration;
+}
+
+void history_init() {
+    for (int i = 0; i < HISTORY_LEVEL_COUNT; i++) {
+        struct DensityLevel *level = &levels[i];
+        level->bin_ms = level_bin_ms[i];
+        level->bin_count = HISTORY_HORIZON_MS / level->bin_ms;
+        level->bin_index = malloc(level->bin_count * sizeof(int));
+        level->sounding_ms =
+            calloc((size_t)level->bin_count * HISTORY_KEYS, sizeof(uint16_t));
+        assert(level->bin_index && level->sounding_ms);
+        for (int b = 0; b < level->bin_count; b++) {
+            level->bin_index[b] = -1;
+        }
+    }
+}
+
+void history_free() {
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < block_count; i++) {
+        free(block_at(i));
+    }
+    first_block = block_count = 0;
+    for (int i = 0; i < HISTORY_LEVEL_COUNT; i++) {
+        free(levels[i].bin_index);
+        free(levels[i].sounding_ms);
+        levels[i].bin_index = NULL;
+        levels[i].sounding_ms = NULL;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void drop_oldest_block() {
+    free(blocks[first_block]);
+    blocks[first_block] = NULL;
+    first_block = (first_block + 1) % MAX_BLOCKS;
+    block_count--;
+}
+
+static struct HistoryBlock *writable_block(int start) {
+    if (block_count > 0) {
+        struct HistoryBlock *last = block_at(block_count - 1);
+        if (last->used + MAX_RECORD_SIZE <= HISTORY_BLOCK_SIZE)
+            return last;
+    }
+
+    if (block_count == MAX_BLOCKS)
+        drop_oldest_block();
+
+    struct HistoryBlock *block = malloc(sizeof(struct HistoryBlock));
+    assert(block);
+    block->first_start = block->last_start = start;
+    block->max_end = start;
+    block->count = block->used = 0;
+
+    blocks[(first_block + block_count) % MAX_BLOCKS] = block;
+    block_count++;
+    return block;
+}
+
+static void add_to_level(struct DensityLevel *level, int key, int start, int end) {
+    int oldest_bin = (newest_end - HISTORY_HORIZON_MS) / level->bin_ms;
+
+    for (int b = start / level->bin_ms; b * level->bin_ms < end; b++) {
+        if (b <= oldest_bin)
+            continue;
+
+        int slot = b % level->bin_count;
+        if (level->bin_index[slot] != b) {
+            // Slot holds a newer bin, this note is older than the horizon
+            if (level->bin_index[slot] > b)
+                continue;
+            memset(&level->sounding_ms[(size_t)slot * HISTORY_KEYS], 0,
+                   HISTORY_KEYS * sizeof(uint16_t));
+            level->bin_index[slot] = b;
+        }
+
+        int bin_start = b * level->bin_ms;
+        int from = start > bin_start ? start : bin_start;
+        int to = end < bin_start + level->bin_ms ? end : bin_start + level->bin_ms;
+
+        uint16_t *ms = &level->sounding_ms[(size_t)slot * HISTORY_KEYS + key];
+        int total = *ms + (to - from);
+        *ms = total < level->bin_ms ? total : level->bin_ms;
+    }
+}
+
+void history_append(const struct Note *note) {
+    int end = note_visible_end(note);
+
+    pthread_mutex_lock(&lock);
+
+    struct HistoryBlock *block = writable_block(note->start);
+    unsigned char *p = block->data + block->used;
+    p = put_varint(p, zigzag(note->start - block->last_start));
+    *p++ = note->note;
+    *p++ = note->velocity;
+    p = put_varint(p, note->end > note->start ? note->end - note->start : 0);
+    p = put_varint(p, note->sus_duration > 0 ? note->sus_duration : 0);
+
+    block->used = p - block->data;
+    block->last_start = note->start;
+    block->count++;
+    if (end > block->max_end)
+        block->max_end = end;
+
+    if (end > newest_end)
+        newest_end = end;
+    for (int i = 0; i < HISTORY_LEVEL_COUNT; i++) {
+        add_to_level(&levels[i], note->note & (HISTORY_KEYS - 1), note->start, end);
+    }
+
+    // Keep the last block, it is the one being written
+    while (block_count > 1 && block_at(0)->max_end < newest_end - HISTORY_HORIZON_MS) {
+        drop_oldest_block();
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+// Room for one more item, called with the history locked
+static void *reserve(void *items, int *capacity, int count, size_t item_size) {
+    if (count < *capacity)
+        return items;
+    *capacity = *capacity ? *capacity * 2 : 256;
+    items = realloc(items, *capacity * item_size);
+    assert(items);
+    return items;
+}
+
+void history_copy_notes(int from_ms, int to_ms, struct HistoryNotes *out) {
+    out->count = 0;
+    pthread_mutex_lock(&lock);
+
+    for (int i = 0; i < block_count; i++) {
+        const struct HistoryBlock *block = block_at(i);
+        if (block->first_start > to_ms)
+            break;
+        if (block->max_end < from_ms)
+            continue;
+
+        const unsigned char *p = block->data;
+        int start = block->first_start;
+        for (int n = 0; n < block->count; n++) {
+            uint32_t delta, duration, sus;
+            struct Note note = {0};
+
+            p = get_varint(p, &delta);
+            start += unzigzag(delta);
+            note.note = *p++;
+            note.velocity = *p++;
+            p = get_varint(p, &duration);
+            p = get_varint(p, &sus);
+
+            note.start = start;
+            note.end = start + duration;
+            note.sus_duration = sus;
+
+            if (note.start <= to_ms && note_visible_end(&note) >= from_ms) {
+                out->items =
+                    reserve(out->items, &out->capacity, out->count, sizeof(struct Note));
+                out->items[out->count++] = note;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+int history_pick_level(int min_bin_ms) {
+    for (int i = 0; i < HISTORY_LEVEL_COUNT; i++) {
+        if (level_bin_ms[i] >= min_bin_ms)
+            return i;
+    }
+    return HISTORY_LEVEL_COUNT - 1;
+}
+
+int history_level_bin_ms(int level) {
+    assert(level >= 0 && level < HISTORY_LEVEL_COUNT);
+    return level_bin_ms[level];
+}
+
+void history_copy_bins(int level_idx, int from_ms, int to_ms, struct HistoryBins *out) {
+    assert(level_idx >= 0 && level_idx < HISTORY_LEVEL_COUNT);
+    const struct DensityLevel *level = &levels[level_idx];
+    out->bin_ms = level->bin_ms;
+    out->count = 0;
+
+    pthread_mutex_lock(&lock);
+
+    int first = from_ms > 0 ? from_ms / level->bin_ms : 0;
+    int last = to_ms / level->bin_ms;
+    for (int b = first; b <= last; b++) {
+        int slot = b % level->bin_count;
+        if (level->bin_index[slot] != b)
+            continue;
+
+        const uint16_t *ms = &level->sounding_ms[(size_t)slot * HISTORY_KEYS];
+        for (int key = 0; key < HISTORY_KEYS; key++) {
+            if (!ms[key])
+                continue;
+            out->items = reserve(out->items, &out->capacity, out->count,
+                                 sizeof(struct HistoryBin));
+            out->items[out->count++] = (struct HistoryBin){
+                .key = key,
+                .start_ms = b * level->bin_ms,
+                .occupancy = (float)ms[key] / level->bin_ms,
+            };
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+int history_oldest_ms() {
+    pthread_mutex_lock(&lock);
+    int oldest = block_count > 0 ? block_at(0)->first_start : 0;
+    pthread_mutex_unlock(&lock);
+    return oldest;
+}
+
+size_t history_memory_bytes() {
+    pthread_mutex_lock(&lock);
+    size_t bytes = (size_t)block_count * sizeof(struct HistoryBlock);
+    for (int i = 0; i < HISTORY_LEVEL_COUNT; i++) {
+        bytes += (size_t)levels[i].bin_count *
+                 (sizeof(int) + HISTORY_KEYS * sizeof(uint16_t));
+    }
+    pthread_mutex_unlock(&lock);
+    return bytes;
+}
@@ -0,0 +1,106 @@
+#include <sigmidi-latency.h>
+#include <assert.h>
+#include <string.h>
+
+static struct Histogram stages[LATENCY_STAGE_COUNT];
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = {
+    [LATENCY_QUEUE_WAIT] = "queue wait",
+    [LATENCY_PROCESSING] = "processing",
+    [LATENCY_FRAME_WAIT] = "frame wait",
+    [LATENCY_PRESENT] = "present",
+    [LATENCY_TOTAL] = "total",
+    [LATENCY_THRU] = "thru",
+};
+
+static int hist_index(uint64_t value) {
+    if (value < (1 << HIST_SUB_BITS))
+        return value;
+
+    int msb = 63 - __builtin_clzll(value);
+    if (msb >= HIST_MAX_MSB)
+        return HIST_BUCKETS - 1;
+
+    int sub = (value >> (msb - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1);
+    return ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + sub;
+}
+
+// Midpoint of the values that land in bucket idx
+static uint64_t hist_value(int idx) {
+    if (idx < (1 << HIST_SUB_BITS))
+        return idx;
+
+    int msb = (idx >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+    int sub = idx & ((1 << HIST_SUB_BITS) - 1);
+    uint64_t width = 1ull << (msb - HIST_SUB_BITS);
+    uint64_t low = ((uint64_t)((1 << HIST_SUB_BITS) + sub)) << (msb - HIST_SUB_BITS);
+    return low + width / 2;
+}
+
+void hist_reset(struct Histogram *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void hist_record(struct Histogram *h, uint64_t value) {
+    h->buckets[hist_index(value)]++;
+    if (h->count == 0 || value < h->min)
+        h->min = value;
+    if (value > h->max)
+        h->max = value;
+    h->count++;
+    h->sum += value;
+}
+
+// p in [0, 100]
+uint64_t hist_percentile(const struct Histogram *h, double p) {
+    if (h->count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * h->count);
+    if (rank >= h->count)
+        rank = h->count - 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > rank) {
+            uint64_t v = hist_value(i);
+            // Bucket midpoints can overshoot the observed range
+            if (v < h->min)
+                return h->min;
+            if (v > h->max)
+                return h->max;
+            return v;
+        }
+    }
+    return h->max;
+}
+
+const char *latency_stage_name(enum LatencyStage stage) {
+    assert(stage < LATENCY_STAGE_COUNT);
+    return stage_names[stage];
+}
+
+const struct Histogram *latency_hist(enum LatencyStage stage) {
+    assert(stage < LATENCY_STAGE_COUNT);
+    return &stages[stage];
+}
+
+void latency_record(enum LatencyStage stage, uint64_t ns) {
+    assert(stage < LATENCY_STAGE_COUNT);
+    hist_record(&stages[stage], ns);
+}
+
+void latency_print_summary(FILE *out) {
+    fprintf(out, "Latency (ms)\n");
+    fprintf(out, "%-12s %8s %8s %8s %8s %8s %8s\n", "stage", "count", "mean", "p50",
+            "p90", "p99", "max");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const struct Histogram *h = &stages[i];
+        double mean = h->count ? (double)h->sum / h->count : 0;
+        fprintf(out, "%-12s %8lu %8.3f %8.3f %8.3f %8.3f %8.3f\n", stage_names[i],
+                (unsigned long)h->count, mean / 1e6, hist_percentile(h, 50) / 1e6,
+                hist_percentile(h, 90) / 1e6, hist_percentile(h, 99) / 1e6,
+                h->max / 1e6);
+    }
+}
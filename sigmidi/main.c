@@ -2,10 +2,22 @@
 #include <assert.h>
 #include <limits.h>
 #include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sigmidi-analytics.h>
+#include <sigmidi-clock.h>
+#include <sigmidi-history.h>
+#include <sigmidi-input.h>
+#include <sigmidi-latency.h>
+#include <sigmidi-metrics.h>
 #include <sigmidi-renderer.h>
+#include <sigmidi-snapshot.h>
+#include <sigmidi-stream.h>
+#include <sigmidi-thru.h>
 #include <sigmidi.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define RINGBUF_IMPLEMENTATION
 #include <3dparty/generic-ringbuf.h>
@@ -13,11 +25,43 @@
 snd_seq_t *handle;
 int local_port;
 int queue_id;
-bool sustain_pedal = false;
-bool sustain_pedal_enabled = false;
+atomic_bool sustain_pedal = false;
+atomic_bool sustain_pedal_enabled = false;
+
+// How long the core thread sleeps without input before running GC again
+#define CORE_POLL_TIMEOUT_MS 10
+
+static atomic_bool core_running;
+static struct SnapshotBuffer snapshots;
+static const struct InputBackend *input = &alsa_input;
+
+// Monotonic time at which the timestamping queue was started
+static uint64_t queue_epoch_ns;
+// Latency bookkeeping, render thread. Every note up to last_presented_id has
+// been recorded, newer ones are recorded once drawn, which is not in order
+// while the view is paused or scrolled back.
+#define PRESENTED_IDS 4096
+static unsigned long last_presented_id;
+static unsigned long presented_ids[PRESENTED_IDS]; // by id % PRESENTED_IDS
+static int *drawn_new;                            // snapshot indices
+static int drawn_new_capacity;
+// Notes that are currently held down, core thread
+static int live_notes;
+// Deepest the event queue got since the last snapshot, it is drained right
+// after every read so its size afterwards says nothing. Core thread
+static int event_queue_peak;
 
 void print_usage() {
-    LOG_ERROR("Usage: sigmidi <client>:<port>");
+    LOG_ERROR("Usage: sigmidi [-l] [-n] [-t] [-c <channels>] [-x <semitones>] "
+              "[<client>:<port>]");
+    LOG_ERROR("       sigmidi [-l] [-n] -i <file>");
+    LOG_ERROR("  -i <file>       read raw MIDI bytes from a file, FIFO or device, "
+              "- for stdin");
+    LOG_ERROR("  -l              vsync, each frame started just in time for it");
+    LOG_ERROR("  -n              with -l, draw for the frame start, not the vsync");
+    LOG_ERROR("  -t              forward incoming events on a thru port");
+    LOG_ERROR("  -c <channels>   only forward these channels, e.g. 1,2,10");
+    LOG_ERROR("  -x <semitones>  transpose forwarded notes, -127 to 127");
 }
 
 void init_seqencer() {
@@ -27,6 +71,8 @@ void init_seqencer() {
     }
 
     snd_seq_set_client_name(handle, "SigMidi Client");
+    // Input is driven by poll() in the core thread, reads must never block
+    snd_seq_nonblock(handle, 1);
 
     local_port = snd_seq_create_simple_port(
         handle, "Read Port", SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
@@ -51,6 +97,7 @@ void init_seqencer() {
 
     snd_seq_start_queue(handle, queue_id, NULL);
     snd_seq_drain_output(handle);
+    queue_epoch_ns = monotonic_ns();
 
     LOG_INFO("Client and Port created successfully: %d:%d", snd_seq_client_id(handle),
              local_port);
@@ -62,19 +109,53 @@ int convert_alsa_real_time_to_ms(snd_seq_real_time_t time) {
     return ms;
 }
 
-static inline struct MidiEvent snd_seq_event_to_midi_event(snd_seq_event_t *alsa_evt) {
+static inline uint64_t convert_alsa_real_time_to_monotonic_ns(snd_seq_real_time_t time) {
+    return queue_epoch_ns + (uint64_t)time.tv_sec * 1000000000ull + time.tv_nsec;
+}
+
+static inline struct MidiEvent snd_seq_event_to_midi_event(snd_seq_event_t *alsa_evt,
+                                                           uint64_t read_ns) {
     // Check if wall clock timestamping is enabled
     assert(alsa_evt->flags & SND_SEQ_TIME_STAMP_REAL);
 
     struct MidiEvent midi_evt = {
         .type = alsa_evt->type,
+        .channel = alsa_evt->data.note.channel,
         .note = alsa_evt->data.note.note,
         .velocity = alsa_evt->data.note.velocity,
         .time = convert_alsa_real_time_to_ms(alsa_evt->time.time),
+        .arrival_ns = convert_alsa_real_time_to_monotonic_ns(alsa_evt->time.time),
+        .read_ns = read_ns,
     };
 
-    if (alsa_evt->type == SND_SEQ_EVENT_NOTEON) {
+    switch (alsa_evt->type) {
+    case SND_SEQ_EVENT_NOTEON:
         LOG_INFO("timestamp: %d ms, velocity: %d", midi_evt.time, midi_evt.velocity);
+        break;
+    case SND_SEQ_EVENT_CONTROLLER:
+    case SND_SEQ_EVENT_PGMCHANGE:
+    case SND_SEQ_EVENT_CHANPRESS:
+        midi_evt.channel = alsa_evt->data.control.channel;
+        midi_evt.note = alsa_evt->data.control.param;
+        midi_evt.velocity = alsa_evt->data.control.value;
+        if (alsa_evt->type != SND_SEQ_EVENT_CONTROLLER) {
+            midi_evt.note = alsa_evt->data.control.value;
+            midi_evt.velocity = 0;
+        }
+        break;
+    case SND_SEQ_EVENT_PITCHBEND:
+    case SND_SEQ_EVENT_SONGPOS: {
+        // Back to the 14 bit value of the wire format
+        int value = alsa_evt->data.control.value;
+        if (alsa_evt->type == SND_SEQ_EVENT_PITCHBEND)
+            value += 8192;
+        midi_evt.channel = alsa_evt->data.control.channel;
+        midi_evt.note = value & 0x7f;
+        midi_evt.velocity = (value >> 7) & 0x7f;
+        break;
+    }
+    default:
+        break;
     }
     return midi_evt;
 }
@@ -94,30 +175,12 @@ void set_sustain_pedal(bool state, int time, struct RingBuf *note_queue) {
             if (time < (note->start + note->sus_duration) && note->sus_duration != 0) {
                 note->end = time;
                 note->sus_duration = 0;
+                note_stream_publish(NOTE_RECORD_END, note, time);
             }
         }
     }
 }
 
-void read_midi_events(struct RingBuf *event_queue, struct RingBuf *note_queue) {
-    snd_seq_event_t *event;
-    while (snd_seq_event_input_pending(handle, 1) > 0) {
-        if (snd_seq_event_input(handle, &event) < 0) {
-            LOG_ERROR("Error in reading MIDI event");
-        }
-
-        struct MidiEvent midi_evt = snd_seq_event_to_midi_event(event);
-        if (event->type == SND_SEQ_EVENT_CONTROLLER && event->data.control.param == 64) {
-            LOG_INFO("sustain pedal - param: %d, value: %d", event->data.control.param,
-                     event->data.control.value);
-
-            set_sustain_pedal(event->data.control.value > 63, midi_evt.time, note_queue);
-        }
-        ringbuf_push(event_queue, &midi_evt);
-        snd_seq_free_event(event);
-    }
-}
-
 // Subscribe the local client to a sender using
 // <client_id>:<port> or <client_name>:<port>
 void subscribe_to_a_sender(char *sender_str) {
@@ -143,6 +206,57 @@ void unsubscribe_to_a_sender(char *sender_str) {
     LOG_INFO("Unsubscribed to %s successfully!", sender_str);
 }
 
+// Subscription changes asked for by the renderer, carried out by the core
+// thread so it stays the only one using `handle`
+#define SUBSCRIPTION_QUEUE_SIZE 8
+
+struct SubscriptionRequest {
+    bool subscribe;
+    char sender[16];
+};
+
+static struct SubscriptionRequest subscription_queue[SUBSCRIPTION_QUEUE_SIZE];
+static int subscription_queue_len;
+static pthread_mutex_t subscription_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void request_subscription(bool subscribe, const char *sender_str) {
+    pthread_mutex_lock(&subscription_lock);
+    if (subscription_queue_len < SUBSCRIPTION_QUEUE_SIZE) {
+        struct SubscriptionRequest *req = &subscription_queue[subscription_queue_len++];
+        req->subscribe = subscribe;
+        snprintf(req->sender, sizeof(req->sender), "%s", sender_str);
+    } else {
+        LOG_WARN("Too many pending subscription changes, dropped %s", sender_str);
+    }
+    pthread_mutex_unlock(&subscription_lock);
+}
+
+void request_subscribe(const char *sender_str) {
+    request_subscription(true, sender_str);
+}
+
+void request_unsubscribe(const char *sender_str) {
+    request_subscription(false, sender_str);
+}
+
+// Core thread
+static void run_subscription_requests() {
+    struct SubscriptionRequest pending[SUBSCRIPTION_QUEUE_SIZE];
+
+    pthread_mutex_lock(&subscription_lock);
+    int count = subscription_queue_len;
+    memcpy(pending, subscription_queue, count * sizeof(struct SubscriptionRequest));
+    subscription_queue_len = 0;
+    pthread_mutex_unlock(&subscription_lock);
+
+    for (int i = 0; i < count; i++) {
+        if (pending[i].subscribe)
+            subscribe_to_a_sender(pending[i].sender);
+        else
+            unsubscribe_to_a_sender(pending[i].sender);
+    }
+}
+
 int alsa_time_now_ms() {
     snd_seq_queue_status_t *q_status;
     snd_seq_queue_status_alloca(&q_status);
@@ -156,6 +270,78 @@ int alsa_time_now_ms() {
     return convert_alsa_real_time_to_ms(*t);
 }
 
+static uint64_t alsa_epoch_ns() {
+    return queue_epoch_ns;
+}
+
+static int alsa_poll_descriptors(struct pollfd *fds, int max) {
+    return snd_seq_poll_descriptors(handle, fds, max, POLLIN);
+}
+
+static int alsa_read_events(struct MidiEvent *events, int max) {
+    snd_seq_event_t *event;
+    int count = 0;
+    while (count < max && snd_seq_event_input_pending(handle, 1) > 0) {
+        if (snd_seq_event_input(handle, &event) < 0) {
+            LOG_ERROR("Error in reading MIDI event");
+            break;
+        }
+
+        if (topology_handle_event(event)) {
+            snd_seq_free_event(event);
+            continue;
+        }
+
+        uint64_t read_ns = monotonic_ns();
+        // Forward before doing any work of our own
+        thru_forward(event, read_ns);
+
+        events[count++] = snd_seq_event_to_midi_event(event, read_ns);
+        snd_seq_free_event(event);
+    }
+    return count;
+}
+
+static void alsa_close() {
+    free_topology();
+    snd_seq_close(handle);
+    handle = NULL;
+}
+
+const struct InputBackend alsa_input = {
+    .name = "alsa",
+    .poll_descriptors = alsa_poll_descriptors,
+    .read_events = alsa_read_events,
+    .now_ms = alsa_time_now_ms,
+    .epoch_ns = alsa_epoch_ns,
+    .close = alsa_close,
+};
+
+// Reads at most one batch, returns the number of events read
+int read_midi_events(struct RingBuf *event_queue, struct RingBuf *note_queue) {
+    struct MidiEvent events[INPUT_BATCH_SIZE];
+    int count = input->read_events(events, INPUT_BATCH_SIZE);
+
+    if (count > 0) {
+        for (int i = 0; i < count; i++) {
+            struct MidiEvent *midi_evt = &events[i];
+
+            metrics_count_event(midi_evt->type);
+            clock_handle_event(midi_evt);
+            if (midi_evt->type == SND_SEQ_EVENT_CONTROLLER && midi_evt->note == 64) {
+                LOG_INFO("sustain pedal - param: %d, value: %d", midi_evt->note,
+                         midi_evt->velocity);
+
+                set_sustain_pedal(midi_evt->velocity > 63, midi_evt->time, note_queue);
+            }
+            ringbuf_push(event_queue, midi_evt);
+        }
+        if (event_queue->size > event_queue_peak)
+            event_queue_peak = event_queue->size;
+    }
+    return count > 0 ? count : 0;
+}
+
 int calc_sustain_duration(struct Note n) {
     int note = n.note;
     int velocity = n.velocity;
@@ -174,6 +360,7 @@ int calc_sustain_duration(struct Note n) {
 // Process the ON/OFF midi events into struct Note with proper timestamping
 void process_midi_events(struct RingBuf *event_queue, struct RingBuf *note_queue) {
     static struct Note *keys[255] = {0};
+    static unsigned long next_note_id = 0;
 
     while (!ringbuf_is_empty(event_queue)) {
         struct MidiEvent midi_evt;
@@ -185,147 +372,276 @@ void process_midi_events(struct RingBuf *event_queue, struct RingBuf *note_queue
             note->velocity = midi_evt.velocity;
             note->start = midi_evt.time;
             note->end = INT_MAX;
+            note->sus_duration = 0;
+            note->id = ++next_note_id;
+            note->arrival_ns = midi_evt.arrival_ns;
+            note->read_ns = midi_evt.read_ns;
+            note->processed_ns = monotonic_ns();
 
             ringbuf_push(note_queue, &note);
             keys[midi_evt.note] = note;
+            live_notes++;
+            note_stream_publish(NOTE_RECORD_BEGIN, note, note->start);
+            analytics_note_on(note);
         } else if (midi_evt.type == SND_SEQ_EVENT_NOTEOFF &&
                    keys[midi_evt.note] != NULL) {
             struct Note *note = keys[midi_evt.note];
             if (sustain_pedal) {
                 note->end = midi_evt.time;
                 note->sus_duration = calc_sustain_duration(*note);
+                note_stream_publish(NOTE_RECORD_SUSTAIN, note, note->end);
             } else {
                 note->end = midi_evt.time;
                 note->sus_duration = 0;
+                note_stream_publish(NOTE_RECORD_END, note, note->end);
             }
             keys[midi_evt.note] = NULL;
+            live_notes--;
+            analytics_note_off(note);
         }
     }
 }
 
-void gc_note_queue(struct RingBuf *note_queue) {
-    if (ringbuf_is_empty(note_queue))
-        return;
-
-    int time_now_ms = alsa_time_now_ms();
+// Returns the number of notes freed
+int gc_note_queue(struct RingBuf *note_queue, int time_now_ms) {
+    int freed = 0;
 
     while (!ringbuf_is_empty(note_queue)) {
         struct Note *item;
         ringubf_peek(note_queue, &item);
-        // TODO: Hardcoded value BAD!!
-        if (item->end + item->sus_duration > (time_now_ms - 5000)) {
+        if (item->end + item->sus_duration > (time_now_ms - LIVE_WINDOW_MS)) {
             break;
         }
 
         ringbuf_pop(note_queue, NULL);
+        history_append(item);
         free(item);
+        freed++;
     }
+    return freed;
 }
 
-void event_loop() {
+static inline uint64_t elapsed_ns(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+static inline bool is_presented(const struct Note *note) {
+    return note->id <= last_presented_id ||
+           presented_ids[note->id % PRESENTED_IDS] == note->id;
+}
+
+// Draw the snapshot, remembering which notes showed up for the first time
+static int draw_snapshot(const struct NoteSnapshot *snapshot) {
+    if (drawn_new_capacity < snapshot->count) {
+        drawn_new_capacity = snapshot->capacity;
+        drawn_new = realloc(drawn_new, drawn_new_capacity * sizeof(int));
+        assert(drawn_new);
+    }
+
+    int count = 0;
+    for (int i = 0; i < snapshot->count; i++) {
+        if (draw_note(snapshot->notes[i]) && !is_presented(&snapshot->notes[i]))
+            drawn_new[count++] = i;
+    }
+    return count;
+}
+
+// Record latencies for the notes that were presented for the first time in
+// this frame
+void record_presented_notes(const struct NoteSnapshot *snapshot, int count,
+                            uint64_t latch_ns, uint64_t present_ns) {
+    for (int i = 0; i < count; i++) {
+        const struct Note *note = &snapshot->notes[drawn_new[i]];
+        presented_ids[note->id % PRESENTED_IDS] = note->id;
+
+        latency_record(LATENCY_QUEUE_WAIT, elapsed_ns(note->arrival_ns, note->read_ns));
+        latency_record(LATENCY_PROCESSING, elapsed_ns(note->read_ns, note->processed_ns));
+        latency_record(LATENCY_FRAME_WAIT, elapsed_ns(note->processed_ns, latch_ns));
+        latency_record(LATENCY_PRESENT, elapsed_ns(latch_ns, present_ns));
+        latency_record(LATENCY_TOTAL, elapsed_ns(note->arrival_ns, present_ns));
+    }
+
+    // Move past the oldest notes that are all done, notes are in id order
+    for (int i = 0; i < snapshot->count && is_presented(&snapshot->notes[i]); i++) {
+        last_presented_id = snapshot->notes[i].id;
+    }
+}
+
+// Copy the current notes into the back buffer and hand it to the renderer
+void publish_snapshot(struct RingBuf *event_queue, struct RingBuf *note_queue) {
+    static uint64_t seq = 0;
+    struct NoteSnapshot *snapshot = snapshot_back(&snapshots);
+
+    snapshot_reserve(snapshot, note_queue->size);
+    for (int i = 0; i < note_queue->size; i++) {
+        int rb_idx = (note_queue->out + i) % note_queue->capacity;
+        snapshot->notes[i] = **(struct Note **)(RINGBUF_AT(note_queue, rb_idx));
+    }
+    snapshot->count = note_queue->size;
+    snapshot->seq = ++seq;
+    snapshot->published_ns = monotonic_ns();
+
+    snapshot->live_notes = live_notes;
+    snapshot->note_queue_size = note_queue->size;
+    snapshot->note_queue_capacity = note_queue->capacity;
+    snapshot->event_queue_size = event_queue_peak;
+    event_queue_peak = event_queue->size;
+    snapshot->event_queue_capacity = event_queue->capacity;
+    snapshot->pool_bytes = (uint64_t)note_queue->size * sizeof(struct Note) +
+                           (uint64_t)note_queue->capacity * note_queue->item_size +
+                           (uint64_t)event_queue->capacity * event_queue->item_size +
+                           3ull * snapshot->capacity * sizeof(struct Note);
+
+    snapshot_publish(&snapshots);
+}
+
+// Input, note processing and GC, decoupled from the frame rate
+void *core_loop(void *arg) {
+    (void)arg;
     struct RingBuf event_queue = ringbuf_alloc(sizeof(struct MidiEvent));
     struct RingBuf note_queue = ringbuf_alloc(sizeof(struct Note *));
 
-    // Start the event loop
-    while (!window_should_close()) {
-        read_midi_events(&event_queue, &note_queue);
-        process_midi_events(&event_queue, &note_queue);
+    struct pollfd fds[INPUT_MAX_POLL_FDS];
 
-        pre_drawing();
-        begin_drawing();
+    publish_snapshot(&event_queue, &note_queue);
+    int batch = 0;
 
-        if (!ringbuf_is_empty(&note_queue)) {
-            for (int i = 0; i < note_queue.size; i++) {
-                int rb_idx = (note_queue.out + i) % note_queue.capacity;
-                draw_note(**(struct Note **)(RINGBUF_AT(&note_queue, rb_idx)));
-            }
+    while (atomic_load(&core_running)) {
+        // Raw input stops handing out descriptors at EOF, poll() then only sleeps.
+        // After a full batch there may be more buffered than poll() can see.
+        int nfds = input->poll_descriptors(fds, INPUT_MAX_POLL_FDS);
+        int timeout_ms = batch == INPUT_BATCH_SIZE ? 0 : CORE_POLL_TIMEOUT_MS;
+        if (poll(fds, nfds, timeout_ms) < 0 && errno != EINTR) {
+            LOG_ERROR("Error polling %s input", input->name);
+            break;
         }
 
-        end_drawing();
-        post_drawing();
+        run_subscription_requests();
 
-        gc_note_queue(&note_queue);
+        batch = read_midi_events(&event_queue, &note_queue);
+        int changed = batch;
+        process_midi_events(&event_queue, &note_queue);
+        // One clock read per wakeup, it is an ioctl on the sequencer
+        int now_ms = input->now_ms();
+        analytics_tick(now_ms);
+
+        uint64_t gc_start_ns = monotonic_ns();
+        int freed = gc_note_queue(&note_queue, now_ms);
+        if (freed) {
+            // Only count passes that collected something, most wakeups have nothing due
+            metrics_record_gc_pause(monotonic_ns() - gc_start_ns);
+            changed += freed;
+        }
+
+        if (changed) {
+            publish_snapshot(&event_queue, &note_queue);
+        }
     }
 
+    while (!ringbuf_is_empty(&note_queue)) {
+        struct Note *note;
+        ringbuf_pop(&note_queue, &note);
+        free(note);
+    }
     ringbuf_free(&event_queue);
     ringbuf_free(&note_queue);
+    return NULL;
 }
 
-void list_seq_clients(struct AlsaClient *client_list, int size) {
-    assert(size > 0);
-    assert(handle != NULL);
-    assert(client_list);
-    memset(client_list, 0, sizeof(struct AlsaClient) * size);
-
-    snd_seq_client_info_t *cinfo;
-    snd_seq_client_info_alloca(&cinfo);
-    snd_seq_client_info_set_client(cinfo, -1);
-
-    int i = 0;
-    while (i < size && snd_seq_query_next_client(handle, cinfo) >= 0) {
-        int id = snd_seq_client_info_get_client(cinfo);
-        if (id != snd_seq_client_id(handle)) {
-            client_list[i].id = id;
-            strcpy(client_list[i].name, snd_seq_client_info_get_name(cinfo));
-            i++;
-        }
-    }
-}
+// Drawing stays on the main thread, it owns the window
+void event_loop() {
+    snapshot_buffer_init(&snapshots);
+    atomic_store(&core_running, true);
 
-int get_seq_client_name(int client_id, char buf[64]) {
-    snd_seq_client_info_t *cinfo;
+    pthread_t core_thread;
+    if (pthread_create(&core_thread, NULL, core_loop, NULL) != 0) {
+        LOG_ERROR("Failed to start the core thread");
+        exit(EXIT_FAILURE);
+    }
 
-    snd_seq_client_info_alloca(&cinfo);
-    snd_seq_client_info_set_client(cinfo, client_id);
+    while (!window_should_close()) {
+        pre_drawing();
+        begin_drawing();
 
-    if (snd_seq_get_any_client_info(handle, client_id, cinfo) < 0)
-        return -1;
+        // Latch the notes as late as possible, after the background is queued
+        const struct NoteSnapshot *snapshot = snapshot_acquire(&snapshots);
+        uint64_t latch_ns = monotonic_ns();
+        int drawn_new_count = draw_snapshot(snapshot);
 
-    const char *name = snd_seq_client_info_get_name(cinfo);
-    if (!name)
-        return -1;
+        end_drawing();
+        uint64_t present_ns = monotonic_ns();
+        record_presented_notes(snapshot, drawn_new_count, latch_ns, present_ns);
+        metrics_record_frame(present_ns);
+        metrics_publish(snapshot);
+        post_drawing();
+    }
 
-    snprintf(buf, 64, "%s", name);
-    return 0;
+    atomic_store(&core_running, false);
+    pthread_join(core_thread, NULL);
+    snapshot_buffer_free(&snapshots);
 }
 
-void list_subscribed_seq_clients(struct AlsaClient *client_list, int size) {
-    assert(size > 0);
-    assert(handle != NULL);
-    assert(client_list);
-    memset(client_list, 0, sizeof(struct AlsaClient) * size);
-
-    snd_seq_query_subscribe_t *query;
-    snd_seq_query_subscribe_alloca(&query);
-
-    snd_seq_addr_t local_addr = {
-        .client = snd_seq_client_id(handle),
-        .port = local_port,
+int main(int argc, char **argv) {
+    struct ThruOptions thru_opt = {
+        .enabled = false,
+        .channel_mask = THRU_ALL_CHANNELS,
+        .transpose = 0,
     };
 
-    snd_seq_query_subscribe_set_root(query, &local_addr);
-    snd_seq_query_subscribe_set_type(query, SND_SEQ_QUERY_SUBS_WRITE);
-    snd_seq_query_subscribe_set_index(query, 0);
-
-    int i = 0;
-    while (i < size && snd_seq_query_port_subscribers(handle, query) == 0) {
-        const snd_seq_addr_t *subscriber = snd_seq_query_subscribe_get_addr(query);
-        client_list[i].id = subscriber->client;
-        get_seq_client_name(subscriber->client, client_list[i].name);
-        i++;
-        snd_seq_query_subscribe_set_index(query, i);
+    const char *raw_path = NULL;
+    bool late_latch = false;
+    bool predict_present = true;
+
+    int c;
+    while ((c = getopt(argc, argv, "tc:x:i:lnh")) != -1) {
+        switch (c) {
+        case 'l':
+            late_latch = true;
+            break;
+        case 'n':
+            predict_present = false;
+            break;
+        case 'i':
+            raw_path = optarg;
+            break;
+        case 't':
+            thru_opt.enabled = true;
+            break;
+        case 'c':
+            if (parse_thru_channels(optarg, &thru_opt.channel_mask) < 0) {
+                LOG_ERROR("Invalid channel list: %s", optarg);
+                print_usage();
+                return -1;
+            }
+            break;
+        case 'x':
+            if (parse_thru_transpose(optarg, &thru_opt.transpose) < 0) {
+                LOG_ERROR("Invalid transpose: %s", optarg);
+                print_usage();
+                return -1;
+            }
+            break;
+        default:
+            print_usage();
+            return -1;
+        }
+    }
+    if (argc - optind > 1 || (raw_path && (thru_opt.enabled || optind < argc))) {
+        print_usage();
+        return -1;
     }
-}
 
-int main(int argc, char **argv) {
-    // if (argc != 2) {
-    //     print_usage();
-    //     return -1;
-    // }
-
-    init_seqencer();
-    if (argc == 2) {
-        subscribe_to_a_sender(argv[1]);
+    if (raw_path) {
+        input = open_raw_input(raw_path);
+        if (!input)
+            return -1;
+    } else {
+        init_seqencer();
+        init_topology();
+        init_thru_port(thru_opt);
+        if (optind < argc) {
+            subscribe_to_a_sender(argv[optind]);
+        }
     }
 
     struct RendererOptions opt = {
@@ -336,12 +652,20 @@ int main(int argc, char **argv) {
         .octave_count = 5,
         .octave_offset = 3,
         .velocity_based_color = true,
+        .predict_present = predict_present,
+        .late_latch = late_latch,
     };
     init_renderer(opt);
+    metrics_init(opt.fps);
+    note_stream_init(input->epoch_ns());
+    history_init();
 
     event_loop();
+    latency_print_summary(stderr);
+    metrics_close();
+    note_stream_close();
+    history_free();
 
-    snd_seq_close(handle);
-    handle = NULL;
+    input->close();
     return 0;
 }
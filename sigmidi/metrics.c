@@ -0,0 +1,166 @@
+#include <sigmidi-latency.h>
+#include <sigmidi-metrics.h>
+#include <sigmidi-shm.h>
+#include <sigmidi-snapshot.h>
+#include <sigmidi.h>
+#include <unistd.h>
+
+#define METRICS_WINDOW_NS 5000000000ull
+#define RATE_WINDOW_NS 1000000000ull
+
+static struct MetricsShm *shm = NULL;
+static int shm_fd = -1;
+
+// Private counters, copied into the segment once per frame. The core thread
+// counters have a single writer, so plain load + store is enough.
+static _Atomic uint64_t events_total[METRICS_EVT_COUNT];
+static uint64_t rate_window_start_ns;
+static uint64_t rate_window_events[METRICS_EVT_COUNT];
+static double events_per_sec[METRICS_EVT_COUNT];
+
+static _Atomic uint64_t gc_runs;
+static _Atomic uint64_t gc_pause_last_ns;
+static _Atomic uint64_t gc_pause_max_ns;
+static _Atomic uint64_t gc_pause_total_ns;
+
+static uint64_t frame_budget_ns;
+static uint64_t last_present_ns;
+static uint64_t frames_total;
+static uint64_t frames_dropped;
+static uint64_t frame_window_start_ns;
+static struct Histogram frame_window;
+static uint64_t frame_time_p50_ns;
+static uint64_t frame_time_p90_ns;
+static uint64_t frame_time_p99_ns;
+static uint64_t frame_time_max_ns;
+
+void metrics_init(int target_fps) {
+    frame_budget_ns = target_fps > 0 ? 1000000000ull / target_fps : 0;
+
+    shm = shm_writer_open(SIGMIDI_METRICS_SHM_NAME, sizeof(struct MetricsShm), "metrics",
+                          &shm_fd);
+    if (shm == NULL)
+        return;
+
+    seqlock_write_begin(&shm->seq);
+    shm->magic = SIGMIDI_METRICS_MAGIC;
+    shm->version = SIGMIDI_METRICS_VERSION;
+    shm->size = sizeof(struct MetricsShm);
+    shm->pid = getpid();
+    shm->target_fps = target_fps;
+    seqlock_write_end(&shm->seq);
+
+    rate_window_start_ns = frame_window_start_ns = monotonic_ns();
+    LOG_INFO("Publishing metrics in shared memory %s", SIGMIDI_METRICS_SHM_NAME);
+}
+
+void metrics_close() {
+    if (shm == NULL)
+        return;
+
+    shm_writer_close(SIGMIDI_METRICS_SHM_NAME, shm, sizeof(struct MetricsShm), shm_fd,
+                     true);
+    shm = NULL;
+}
+
+static inline uint64_t load(_Atomic uint64_t *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static inline void store(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, value, memory_order_relaxed);
+}
+
+void metrics_count_event(int snd_seq_event_type) {
+    enum MetricsEventType type;
+    switch (snd_seq_event_type) {
+    case SND_SEQ_EVENT_NOTEON:
+        type = METRICS_EVT_NOTEON;
+        break;
+    case SND_SEQ_EVENT_NOTEOFF:
+        type = METRICS_EVT_NOTEOFF;
+        break;
+    case SND_SEQ_EVENT_CONTROLLER:
+        type = METRICS_EVT_CONTROLLER;
+        break;
+    default:
+        type = METRICS_EVT_OTHER;
+        break;
+    }
+    store(&events_total[type], load(&events_total[type]) + 1);
+}
+
+void metrics_record_gc_pause(uint64_t ns) {
+    store(&gc_runs, load(&gc_runs) + 1);
+    store(&gc_pause_last_ns, ns);
+    store(&gc_pause_total_ns, load(&gc_pause_total_ns) + ns);
+    if (ns > load(&gc_pause_max_ns))
+        store(&gc_pause_max_ns, ns);
+}
+
+void metrics_record_frame(uint64_t present_ns) {
+    frames_total++;
+    if (last_present_ns != 0) {
+        uint64_t frame_ns = present_ns - last_present_ns;
+        hist_record(&frame_window, frame_ns);
+        // Anything over 1.5 frame budgets missed at least one vsync
+        if (frame_budget_ns && frame_ns > frame_budget_ns * 3 / 2)
+            frames_dropped++;
+    }
+    last_present_ns = present_ns;
+
+    if (present_ns - frame_window_start_ns >= METRICS_WINDOW_NS) {
+        frame_time_p50_ns = hist_percentile(&frame_window, 50);
+        frame_time_p90_ns = hist_percentile(&frame_window, 90);
+        frame_time_p99_ns = hist_percentile(&frame_window, 99);
+        frame_time_max_ns = frame_window.max;
+        hist_reset(&frame_window);
+        frame_window_start_ns = present_ns;
+    }
+}
+
+void metrics_publish(const struct NoteSnapshot *snapshot) {
+    uint64_t now = monotonic_ns();
+
+    if (now - rate_window_start_ns >= RATE_WINDOW_NS) {
+        double secs = (now - rate_window_start_ns) / 1e9;
+        for (int i = 0; i < METRICS_EVT_COUNT; i++) {
+            uint64_t total = load(&events_total[i]);
+            events_per_sec[i] = (total - rate_window_events[i]) / secs;
+            rate_window_events[i] = total;
+        }
+        rate_window_start_ns = now;
+    }
+
+    if (shm == NULL)
+        return;
+
+    seqlock_write_begin(&shm->seq);
+
+    shm->update_ns = now;
+    for (int i = 0; i < METRICS_EVT_COUNT; i++) {
+        shm->events_total[i] = load(&events_total[i]);
+        shm->events_per_sec[i] = events_per_sec[i];
+    }
+
+    shm->live_notes = snapshot->live_notes;
+    shm->note_queue_size = snapshot->note_queue_size;
+    shm->note_queue_capacity = snapshot->note_queue_capacity;
+    shm->event_queue_size = snapshot->event_queue_size;
+    shm->event_queue_capacity = snapshot->event_queue_capacity;
+    shm->pool_bytes = snapshot->pool_bytes;
+
+    shm->gc_runs = load(&gc_runs);
+    shm->gc_pause_last_ns = load(&gc_pause_last_ns);
+    shm->gc_pause_max_ns = load(&gc_pause_max_ns);
+    shm->gc_pause_total_ns = load(&gc_pause_total_ns);
+
+    shm->frames_total = frames_total;
+    shm->frames_dropped = frames_dropped;
+    shm->frame_time_p50_ns = frame_time_p50_ns;
+    shm->frame_time_p90_ns = frame_time_p90_ns;
+    shm->frame_time_p99_ns = frame_time_p99_ns;
+    shm->frame_time_max_ns = frame_time_max_ns;
+
+    seqlock_write_end(&shm->seq);
+}
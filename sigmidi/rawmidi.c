@@ -0,0 +1,236 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sigmidi-input.h>
+#include <string.h>
+#include <unistd.h>
+
+enum RawByteKind {
+    RAW_DATA,
+    RAW_CHANNEL,   // channel voice message, sets running status
+    RAW_COMMON,    // system common message, clears running status
+    RAW_SYSEX,     // start of SysEx, skipped up to the next status byte
+    RAW_SYSEX_END,
+    RAW_REALTIME,  // single byte, may appear anywhere without side effects
+};
+
+struct RawByteInfo {
+    uint8_t kind;
+    uint8_t len;  // data bytes that follow a status byte
+    uint8_t type; // snd_seq_event_type_t to emit, 0 for messages we drop
+};
+
+static const struct RawByteInfo byte_table[256] = {
+    [0x00 ... 0x7f] = {RAW_DATA, 0, 0},
+    [0x80 ... 0x8f] = {RAW_CHANNEL, 2, SND_SEQ_EVENT_NOTEOFF},
+    [0x90 ... 0x9f] = {RAW_CHANNEL, 2, SND_SEQ_EVENT_NOTEON},
+    [0xa0 ... 0xaf] = {RAW_CHANNEL, 2, SND_SEQ_EVENT_KEYPRESS},
+    [0xb0 ... 0xbf] = {RAW_CHANNEL, 2, SND_SEQ_EVENT_CONTROLLER},
+    [0xc0 ... 0xcf] = {RAW_CHANNEL, 1, SND_SEQ_EVENT_PGMCHANGE},
+    [0xd0 ... 0xdf] = {RAW_CHANNEL, 1, SND_SEQ_EVENT_CHANPRESS},
+    [0xe0 ... 0xef] = {RAW_CHANNEL, 2, SND_SEQ_EVENT_PITCHBEND},
+    [0xf0] = {RAW_SYSEX, 0, 0},
+    [0xf1] = {RAW_COMMON, 1, 0}, // MTC quarter frame
+    [0xf2] = {RAW_COMMON, 2, SND_SEQ_EVENT_SONGPOS},
+    [0xf3] = {RAW_COMMON, 1, 0}, // song select
+    [0xf4 ... 0xf6] = {RAW_COMMON, 0, 0},
+    [0xf7] = {RAW_SYSEX_END, 0, 0},
+    [0xf8] = {RAW_REALTIME, 0, SND_SEQ_EVENT_CLOCK},
+    [0xf9] = {RAW_REALTIME, 0, 0},
+    [0xfa] = {RAW_REALTIME, 0, SND_SEQ_EVENT_START},
+    [0xfb] = {RAW_REALTIME, 0, SND_SEQ_EVENT_CONTINUE},
+    [0xfc] = {RAW_REALTIME, 0, SND_SEQ_EVENT_STOP},
+    [0xfd ... 0xff] = {RAW_REALTIME, 0, 0}, // active sensing and reset
+};
+
+void rawmidi_parser_init(struct RawMidiParser *p) {
+    memset(p, 0, sizeof(*p));
+}
+
+static inline void emit(struct MidiEvent *e, uint8_t status, const uint8_t *data,
+                        int time_ms, uint64_t time_ns) {
+    e->type = byte_table[status].type;
+    e->channel = status < 0xf0 ? status & 0x0f : 0;
+    e->note = data[0];
+    e->velocity = data[1];
+    // MIDI allows a note on with velocity 0 as a note off, used with running status
+    if (e->type == SND_SEQ_EVENT_NOTEON && e->velocity == 0)
+        e->type = SND_SEQ_EVENT_NOTEOFF;
+    e->time = time_ms;
+    e->arrival_ns = time_ns;
+    e->read_ns = time_ns;
+}
+
+int rawmidi_parse(struct RawMidiParser *p, const uint8_t *buf, size_t len,
+                  struct MidiEvent *events, int max, int time_ms, uint64_t time_ns,
+                  size_t *consumed) {
+    static const uint8_t no_data[2] = {0, 0};
+    int n = 0;
+    size_t i;
+
+    // Every byte completes at most one event, so checking first is enough
+    for (i = 0; i < len && n < max; i++) {
+        uint8_t b = buf[i];
+        const struct RawByteInfo *info = &byte_table[b];
+
+        switch (info->kind) {
+        case RAW_DATA:
+            if (p->in_sysex || p->status == 0)
+                break;
+            p->data[p->have++] = b;
+            if (p->have < byte_table[p->status].len)
+                break;
+            if (p->have == 1)
+                p->data[1] = 0;
+            p->have = 0;
+            if (byte_table[p->status].type)
+                emit(&events[n++], p->status, p->data, time_ms, time_ns);
+            // Running status only applies to channel messages
+            if (byte_table[p->status].kind == RAW_COMMON)
+                p->status = 0;
+            break;
+        case RAW_CHANNEL:
+        case RAW_COMMON:
+            p->in_sysex = 0;
+            p->have = 0;
+            p->status = b;
+            if (info->len == 0) {
+                if (info->type)
+                    emit(&events[n++], b, no_data, time_ms, time_ns);
+                p->status = 0;
+            }
+            break;
+        case RAW_SYSEX:
+            p->in_sysex = 1;
+            p->status = 0;
+            break;
+        case RAW_SYSEX_END:
+            p->in_sysex = 0;
+            p->status = 0;
+            break;
+        case RAW_REALTIME:
+            if (info->type)
+                emit(&events[n++], b, no_data, time_ms, time_ns);
+            break;
+        }
+    }
+
+    *consumed = i;
+    return n;
+}
+
+// Raw MIDI backend
+
+// A byte stream carries no timestamps, so bytes that come in with one read()
+// can't be told apart in time. Small reads keep that to the few bytes that
+// arrive between two wakeups of the core thread on a live device, ~3 per ms at
+// the MIDI wire rate.
+#define RAW_READ_SIZE 64
+
+static struct {
+    int fd;
+    bool eof;
+    struct RawMidiParser parser;
+    uint8_t buf[RAW_READ_SIZE];
+    size_t pos;
+    size_t len;
+    uint64_t epoch_ns;
+} raw = {.fd = -1};
+
+static int raw_now_ms() {
+    return (monotonic_ns() - raw.epoch_ns) / 1000000;
+}
+
+static uint64_t raw_epoch_ns() {
+    return raw.epoch_ns;
+}
+
+static int raw_poll_descriptors(struct pollfd *fds, int max) {
+    if (raw.eof || max < 1)
+        return 0;
+    fds[0].fd = raw.fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    return 1;
+}
+
+// Read more input if there is some waiting, false otherwise. The descriptor
+// stays blocking (stdin is shared with the shell), poll() says when a read
+// won't wait.
+static bool raw_fill() {
+    if (raw.eof)
+        return false;
+
+    struct pollfd pfd = {.fd = raw.fd, .events = POLLIN};
+    if (poll(&pfd, 1, 0) <= 0)
+        return false;
+
+    ssize_t n = read(raw.fd, raw.buf, sizeof(raw.buf));
+    if (n < 0) {
+        if (errno == EINTR)
+            return false;
+        LOG_ERROR("Error reading raw MIDI input: %s", strerror(errno));
+        raw.eof = true;
+        return false;
+    }
+    if (n == 0) {
+        LOG_INFO("Raw MIDI input ended");
+        raw.eof = true;
+        return false;
+    }
+    raw.pos = 0;
+    raw.len = n;
+    return true;
+}
+
+static int raw_read_events(struct MidiEvent *events, int max) {
+    int count = 0;
+    while (count < max) {
+        if (raw.pos == raw.len && !raw_fill())
+            break;
+
+        // One message at a time so each gets the time it was parsed at
+        uint64_t now_ns = monotonic_ns();
+        size_t consumed;
+        count += rawmidi_parse(&raw.parser, raw.buf + raw.pos, raw.len - raw.pos,
+                               events + count, 1, (now_ns - raw.epoch_ns) / 1000000,
+                               now_ns, &consumed);
+        raw.pos += consumed;
+    }
+    return count;
+}
+
+static void raw_close() {
+    if (raw.fd > STDERR_FILENO)
+        close(raw.fd);
+    raw.fd = -1;
+}
+
+static const struct InputBackend raw_input = {
+    .name = "raw",
+    .poll_descriptors = raw_poll_descriptors,
+    .read_events = raw_read_events,
+    .now_ms = raw_now_ms,
+    .epoch_ns = raw_epoch_ns,
+    .close = raw_close,
+};
+
+const struct InputBackend *open_raw_input(const char *path) {
+    if (strcmp(path, "-") == 0) {
+        raw.fd = STDIN_FILENO;
+    } else {
+        // Blocks until a FIFO has a writer
+        raw.fd = open(path, O_RDONLY);
+        if (raw.fd < 0) {
+            LOG_ERROR("Failed to open raw MIDI input %s: %s", path, strerror(errno));
+            return NULL;
+        }
+    }
+
+    rawmidi_parser_init(&raw.parser);
+    raw.eof = false;
+    raw.pos = raw.len = 0;
+    raw.epoch_ns = monotonic_ns();
+
+    LOG_INFO("Reading raw MIDI from %s", path);
+    return &raw_input;
+}
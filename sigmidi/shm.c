@@ -0,0 +1,45 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sigmidi-shm.h>
+#include <sigmidi.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+void *shm_writer_open(const char *name, size_t size, const char *what, int *fd) {
+    *fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (*fd < 0) {
+        LOG_WARN("Failed to open shared memory %s, %s disabled", name, what);
+        return NULL;
+    }
+    if (flock(*fd, LOCK_EX | LOCK_NB) < 0) {
+        if (errno == EWOULDBLOCK)
+            LOG_WARN("Shared memory %s is in use by another sigmidi, %s disabled", name,
+                     what);
+        else
+            LOG_WARN("Failed to lock shared memory %s, %s disabled", name, what);
+        close(*fd);
+        return NULL;
+    }
+    if (ftruncate(*fd, size) < 0) {
+        LOG_WARN("Failed to size shared memory %s, %s disabled", name, what);
+        close(*fd);
+        return NULL;
+    }
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (mem == MAP_FAILED) {
+        LOG_WARN("Failed to map shared memory %s, %s disabled", name, what);
+        close(*fd);
+        return NULL;
+    }
+    return mem;
+}
+
+void shm_writer_close(const char *name, void *mem, size_t size, int fd,
+                      bool unlink_segment) {
+    munmap(mem, size);
+    if (unlink_segment)
+        shm_unlink(name);
+    close(fd); // releases the lock
+}
@@ -0,0 +1,53 @@
+#include <assert.h>
+#include <sigmidi-snapshot.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_DIRTY 4
+#define SNAPSHOT_INDEX 3
+
+void snapshot_buffer_init(struct SnapshotBuffer *sb) {
+    memset(sb->slots, 0, sizeof(sb->slots));
+    sb->front = 0;
+    atomic_init(&sb->middle, 1);
+    sb->back = 2;
+}
+
+void snapshot_buffer_free(struct SnapshotBuffer *sb) {
+    for (int i = 0; i < 3; i++) {
+        free(sb->slots[i].notes);
+        sb->slots[i].notes = NULL;
+        sb->slots[i].count = sb->slots[i].capacity = 0;
+    }
+}
+
+struct NoteSnapshot *snapshot_back(struct SnapshotBuffer *sb) {
+    return &sb->slots[sb->back];
+}
+
+void snapshot_reserve(struct NoteSnapshot *snapshot, int count) {
+    if (count <= snapshot->capacity)
+        return;
+
+    int capacity = snapshot->capacity ? snapshot->capacity : 64;
+    while (capacity < count)
+        capacity *= 2;
+
+    snapshot->notes = realloc(snapshot->notes, capacity * sizeof(struct Note));
+    assert(snapshot->notes);
+    snapshot->capacity = capacity;
+}
+
+void snapshot_publish(struct SnapshotBuffer *sb) {
+    int prev = atomic_exchange_explicit(&sb->middle, sb->back | SNAPSHOT_DIRTY,
+                                        memory_order_acq_rel);
+    sb->back = prev & SNAPSHOT_INDEX;
+}
+
+const struct NoteSnapshot *snapshot_acquire(struct SnapshotBuffer *sb) {
+    if (atomic_load_explicit(&sb->middle, memory_order_relaxed) & SNAPSHOT_DIRTY) {
+        int prev = atomic_exchange_explicit(&sb->middle, sb->front, memory_order_acq_rel);
+        sb->front = prev & SNAPSHOT_INDEX;
+    }
+    return &sb->slots[sb->front];
+}
@@ -0,0 +1,65 @@
+#include <sigmidi-shm.h>
+#include <sigmidi-stream.h>
+#include <sigmidi.h>
+#include <unistd.h>
+
+static struct NoteStreamShm *shm = NULL;
+static int shm_fd = -1;
+static uint64_t head;
+
+void note_stream_init(uint64_t time_origin_ns) {
+    shm = shm_writer_open(SIGMIDI_STREAM_SHM_NAME, sizeof(struct NoteStreamShm),
+                          "note stream", &shm_fd);
+    if (shm == NULL)
+        return;
+
+    // Readers attached to an earlier run hold off until the new generation
+    atomic_store_explicit(&shm->generation, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    head = 0;
+    for (int i = 0; i < SIGMIDI_STREAM_CAPACITY; i++) {
+        atomic_store_explicit(&shm->records[i].seq, 0, memory_order_relaxed);
+    }
+    shm->magic = SIGMIDI_STREAM_MAGIC;
+    shm->version = SIGMIDI_STREAM_VERSION;
+    shm->size = sizeof(struct NoteStreamShm);
+    shm->capacity = SIGMIDI_STREAM_CAPACITY;
+    shm->pid = getpid();
+    shm->time_origin_ns = time_origin_ns;
+    atomic_store_explicit(&shm->head, head, memory_order_relaxed);
+    atomic_store_explicit(&shm->generation, monotonic_ns(), memory_order_release);
+
+    LOG_INFO("Publishing note stream in shared memory %s", SIGMIDI_STREAM_SHM_NAME);
+}
+
+void note_stream_close() {
+    if (shm == NULL)
+        return;
+
+    // Left in place for the readers, the next run picks it up
+    shm_writer_close(SIGMIDI_STREAM_SHM_NAME, shm, sizeof(struct NoteStreamShm), shm_fd,
+                     false);
+    shm = NULL;
+}
+
+void note_stream_publish(enum NoteRecordType type, const struct Note *note, int time) {
+    if (shm == NULL)
+        return;
+
+    struct NoteRecord *rec = &shm->records[head & (SIGMIDI_STREAM_CAPACITY - 1)];
+
+    atomic_store_explicit(&rec->seq, 2 * head + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    rec->id = note->id;
+    rec->time = time;
+    rec->sus_duration = type == NOTE_RECORD_SUSTAIN ? note->sus_duration : 0;
+    rec->type = type;
+    rec->note = note->note;
+    rec->velocity = note->velocity;
+
+    atomic_store_explicit(&rec->seq, 2 * head + 2, memory_order_release);
+    head++;
+    atomic_store_explicit(&shm->head, head, memory_order_release);
+}
@@ -0,0 +1,109 @@
+#include <errno.h>
+#include <sigmidi-latency.h>
+#include <sigmidi-thru.h>
+#include <sigmidi.h>
+#include <stdlib.h>
+
+static struct ThruOptions thru = {0};
+static int thru_port = -1;
+
+void init_thru_port(struct ThruOptions options) {
+    thru = options;
+    if (!thru.enabled)
+        return;
+
+    thru_port = snd_seq_create_simple_port(
+        handle, "Thru Port", SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ,
+        SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+
+    if (thru_port < 0) {
+        LOG_ERROR("Error creating thru port");
+        exit(EXIT_FAILURE);
+    }
+
+    LOG_INFO("Thru port created: %d:%d (channels 0x%04x, transpose %+d)",
+             snd_seq_client_id(handle), thru_port, thru.channel_mask, thru.transpose);
+}
+
+int parse_thru_channels(const char *str, uint16_t *mask) {
+    *mask = 0;
+    while (*str) {
+        char *end;
+        long channel = strtol(str, &end, 10);
+        if (end == str || channel < 1 || channel > 16)
+            return -1;
+
+        *mask |= 1 << (channel - 1);
+        str = end;
+        if (*str == ',')
+            str++;
+        else if (*str)
+            return -1;
+    }
+    return *mask ? 0 : -1;
+}
+
+int parse_thru_transpose(const char *str, int *transpose) {
+    char *end;
+    errno = 0;
+    long semitones = strtol(str, &end, 10);
+    if (end == str || *end || errno == ERANGE)
+        return -1;
+
+    // Anything further moves every note out of range
+    if (semitones > 127)
+        semitones = 127;
+    else if (semitones < -127)
+        semitones = -127;
+    *transpose = semitones;
+    return 0;
+}
+
+// Channel of a channel voice message, -1 for everything else
+static int event_channel(const snd_seq_event_t *event) {
+    switch (event->type) {
+    case SND_SEQ_EVENT_NOTEON:
+    case SND_SEQ_EVENT_NOTEOFF:
+    case SND_SEQ_EVENT_KEYPRESS:
+        return event->data.note.channel;
+    case SND_SEQ_EVENT_CONTROLLER:
+    case SND_SEQ_EVENT_PGMCHANGE:
+    case SND_SEQ_EVENT_CHANPRESS:
+    case SND_SEQ_EVENT_PITCHBEND:
+        return event->data.control.channel;
+    default:
+        return -1;
+    }
+}
+
+void thru_forward(const snd_seq_event_t *event, uint64_t read_ns) {
+    if (thru_port < 0 || event->dest.port != local_port)
+        return;
+
+    int channel = event_channel(event);
+    if (channel >= 0 && !(thru.channel_mask & (1 << (channel & 0x0f))))
+        return;
+
+    snd_seq_event_t out = *event;
+
+    if (thru.transpose != 0 &&
+        (out.type == SND_SEQ_EVENT_NOTEON || out.type == SND_SEQ_EVENT_NOTEOFF ||
+         out.type == SND_SEQ_EVENT_KEYPRESS)) {
+        int note = out.data.note.note + thru.transpose;
+        if (note < 0 || note > 127)
+            return;
+        out.data.note.note = note;
+    }
+
+    snd_seq_ev_set_source(&out, thru_port);
+    snd_seq_ev_set_subs(&out);
+    snd_seq_ev_set_direct(&out);
+
+    if (snd_seq_event_output_direct(handle, &out) < 0) {
+        LOG_WARN("Failed to forward event on thru port");
+        return;
+    }
+
+    uint64_t sent_ns = monotonic_ns();
+    latency_record(LATENCY_THRU, sent_ns > read_ns ? sent_ns - read_ns : 0);
+}
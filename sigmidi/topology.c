@@ -0,0 +1,260 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sigmidi.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * In-memory copy of the sequencer topology, kept up to date from the System
+ * Announce port so readers never have to go through sequencer ioctls. The core
+ * thread updates it under `lock`, readers take the same lock.
+ */
+struct ClientArray {
+    struct AlsaClient *items;
+    int count;
+    int capacity;
+};
+
+static struct ClientArray clients;
+static struct ClientArray subs;
+static unsigned long generation;
+static int announce_port = -1;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int find_client(struct ClientArray *arr, int id, int port) {
+    for (int i = 0; i < arr->count; i++) {
+        if (arr->items[i].id == id && (port < 0 || arr->items[i].port == port))
+            return i;
+    }
+    return -1;
+}
+
+static void upsert_client(struct ClientArray *arr, struct AlsaClient client) {
+    int idx = find_client(arr, client.id, client.port);
+    if (idx < 0) {
+        if (arr->count == arr->capacity) {
+            arr->capacity = arr->capacity ? arr->capacity * 2 : 16;
+            arr->items = realloc(arr->items, arr->capacity * sizeof(struct AlsaClient));
+            assert(arr->items);
+        }
+        idx = arr->count++;
+    }
+    arr->items[idx] = client;
+    generation++;
+}
+
+// Remove every entry of client id, or only id:port when port >= 0
+static void remove_client(struct ClientArray *arr, int id, int port) {
+    int idx;
+    while ((idx = find_client(arr, id, port)) >= 0) {
+        memmove(&arr->items[idx], &arr->items[idx + 1],
+                (arr->count - idx - 1) * sizeof(struct AlsaClient));
+        arr->count--;
+        generation++;
+    }
+}
+
+static int get_seq_client_name(int client_id, char buf[64]) {
+    // Avoid the ioctl for clients we already know
+    int idx = find_client(&clients, client_id, -1);
+    if (idx >= 0) {
+        snprintf(buf, 64, "%s", clients.items[idx].name);
+        return 0;
+    }
+
+    snd_seq_client_info_t *cinfo;
+
+    snd_seq_client_info_alloca(&cinfo);
+    snd_seq_client_info_set_client(cinfo, client_id);
+
+    if (snd_seq_get_any_client_info(handle, client_id, cinfo) < 0)
+        return -1;
+
+    const char *name = snd_seq_client_info_get_name(cinfo);
+    if (!name)
+        return -1;
+
+    snprintf(buf, 64, "%s", name);
+    return 0;
+}
+
+static void refresh_client(int client_id) {
+    if (client_id == snd_seq_client_id(handle))
+        return;
+
+    snd_seq_client_info_t *cinfo;
+    snd_seq_client_info_alloca(&cinfo);
+    if (snd_seq_get_any_client_info(handle, client_id, cinfo) < 0)
+        return;
+
+    const char *name = snd_seq_client_info_get_name(cinfo);
+    struct AlsaClient client = {.id = client_id, .port = 0};
+    snprintf(client.name, sizeof(client.name), "%s", name ? name : "");
+    upsert_client(&clients, client);
+
+    // Keep the names of the subscriptions in sync
+    for (int i = 0; i < subs.count; i++) {
+        if (subs.items[i].id == client_id)
+            memcpy(subs.items[i].name, client.name, sizeof(client.name));
+    }
+}
+
+static void add_subscription(snd_seq_addr_t sender) {
+    struct AlsaClient sub = {.id = sender.client, .port = sender.port};
+    if (get_seq_client_name(sender.client, sub.name) < 0)
+        return;
+    upsert_client(&subs, sub);
+}
+
+static void load_clients() {
+    snd_seq_client_info_t *cinfo;
+    snd_seq_client_info_alloca(&cinfo);
+    snd_seq_client_info_set_client(cinfo, -1);
+
+    while (snd_seq_query_next_client(handle, cinfo) >= 0) {
+        int id = snd_seq_client_info_get_client(cinfo);
+        if (id == snd_seq_client_id(handle))
+            continue;
+
+        struct AlsaClient client = {.id = id, .port = 0};
+        snprintf(client.name, sizeof(client.name), "%s",
+                 snd_seq_client_info_get_name(cinfo));
+        upsert_client(&clients, client);
+    }
+}
+
+static void load_subscriptions() {
+    snd_seq_query_subscribe_t *query;
+    snd_seq_query_subscribe_alloca(&query);
+
+    snd_seq_addr_t local_addr = {
+        .client = snd_seq_client_id(handle),
+        .port = local_port,
+    };
+
+    snd_seq_query_subscribe_set_root(query, &local_addr);
+    snd_seq_query_subscribe_set_type(query, SND_SEQ_QUERY_SUBS_WRITE);
+    snd_seq_query_subscribe_set_index(query, 0);
+
+    int i = 0;
+    while (snd_seq_query_port_subscribers(handle, query) == 0) {
+        add_subscription(*snd_seq_query_subscribe_get_addr(query));
+        i++;
+        snd_seq_query_subscribe_set_index(query, i);
+    }
+}
+
+// Subscribe to the System Announce port and load the current topology once
+void init_topology() {
+    assert(handle != NULL);
+
+    announce_port = snd_seq_create_simple_port(
+        handle, "Announce Port",
+        SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE | SND_SEQ_PORT_CAP_NO_EXPORT,
+        SND_SEQ_PORT_TYPE_APPLICATION);
+
+    if (announce_port < 0) {
+        LOG_ERROR("Error creating announce port");
+        exit(EXIT_FAILURE);
+    }
+
+    if (snd_seq_connect_from(handle, announce_port, SND_SEQ_CLIENT_SYSTEM,
+                             SND_SEQ_PORT_SYSTEM_ANNOUNCE) < 0) {
+        LOG_ERROR("Error subscribing to the System Announce port");
+        exit(EXIT_FAILURE);
+    }
+
+    load_clients();
+    load_subscriptions();
+}
+
+// Update the cache from an announcement, false if event is not one
+bool topology_handle_event(const snd_seq_event_t *event) {
+    if (announce_port < 0 || event->dest.port != announce_port)
+        return false;
+
+    int own_client = snd_seq_client_id(handle);
+
+    pthread_mutex_lock(&lock);
+    switch (event->type) {
+    case SND_SEQ_EVENT_CLIENT_START:
+    case SND_SEQ_EVENT_CLIENT_CHANGE:
+        refresh_client(event->data.addr.client);
+        break;
+    case SND_SEQ_EVENT_CLIENT_EXIT:
+        remove_client(&clients, event->data.addr.client, -1);
+        remove_client(&subs, event->data.addr.client, -1);
+        break;
+    case SND_SEQ_EVENT_PORT_EXIT:
+        remove_client(&subs, event->data.addr.client, event->data.addr.port);
+        break;
+    case SND_SEQ_EVENT_PORT_SUBSCRIBED:
+        if (event->data.connect.dest.client == own_client &&
+            event->data.connect.dest.port == local_port) {
+            add_subscription(event->data.connect.sender);
+        }
+        break;
+    case SND_SEQ_EVENT_PORT_UNSUBSCRIBED:
+        if (event->data.connect.dest.client == own_client &&
+            event->data.connect.dest.port == local_port) {
+            remove_client(&subs, event->data.connect.sender.client,
+                          event->data.connect.sender.port);
+        }
+        break;
+    default:
+        // Port start/change do not affect the client or subscription lists
+        break;
+    }
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+void topology_lock() {
+    pthread_mutex_lock(&lock);
+}
+
+void topology_unlock() {
+    pthread_mutex_unlock(&lock);
+}
+
+// Only valid between topology_lock() and topology_unlock()
+const struct Topology *get_topology() {
+    static struct Topology topology;
+    topology.clients = clients.items;
+    topology.client_count = clients.count;
+    topology.subs = subs.items;
+    topology.sub_count = subs.count;
+    topology.generation = generation;
+    return &topology;
+}
+
+void list_seq_clients(struct AlsaClient *client_list, int size) {
+    assert(size > 0);
+    assert(client_list);
+    memset(client_list, 0, sizeof(struct AlsaClient) * size);
+
+    pthread_mutex_lock(&lock);
+    int n = clients.count < size ? clients.count : size;
+    if (n > 0)
+        memcpy(client_list, clients.items, n * sizeof(struct AlsaClient));
+    pthread_mutex_unlock(&lock);
+}
+
+void list_subscribed_seq_clients(struct AlsaClient *client_list, int size) {
+    assert(size > 0);
+    assert(client_list);
+    memset(client_list, 0, sizeof(struct AlsaClient) * size);
+
+    pthread_mutex_lock(&lock);
+    int n = subs.count < size ? subs.count : size;
+    if (n > 0)
+        memcpy(client_list, subs.items, n * sizeof(struct AlsaClient));
+    pthread_mutex_unlock(&lock);
+}
+
+void free_topology() {
+    free(clients.items);
+    free(subs.items);
+    clients = (struct ClientArray){0};
+    subs = (struct ClientArray){0};
+}
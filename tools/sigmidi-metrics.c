@@ -0,0 +1,105 @@
+// Print the metrics published by a running sigmidi in Prometheus text format
+#include <fcntl.h>
+#include <sigmidi-metrics.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const char *event_type_names[METRICS_EVT_COUNT] = {
+    [METRICS_EVT_NOTEON] = "noteon",
+    [METRICS_EVT_NOTEOFF] = "noteoff",
+    [METRICS_EVT_CONTROLLER] = "controller",
+    [METRICS_EVT_OTHER] = "other",
+};
+
+static void print_metric(const char *name, const char *type, const char *help,
+                         double value) {
+    printf("# HELP sigmidi_%s %s\n", name, help);
+    printf("# TYPE sigmidi_%s %s\n", name, type);
+    printf("sigmidi_%s %.17g\n", name, value);
+}
+
+static void print_frame_time(const char *quantile, uint64_t ns) {
+    printf("sigmidi_frame_time_seconds{quantile=\"%s\"} %.9f\n", quantile, ns / 1e9);
+}
+
+int main() {
+    int fd = shm_open(SIGMIDI_METRICS_SHM_NAME, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[ERROR] sigmidi is not running (no %s)\n",
+                SIGMIDI_METRICS_SHM_NAME);
+        return EXIT_FAILURE;
+    }
+
+    const struct MetricsShm *shm =
+        mmap(NULL, sizeof(struct MetricsShm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        fprintf(stderr, "[ERROR] Failed to map %s\n", SIGMIDI_METRICS_SHM_NAME);
+        return EXIT_FAILURE;
+    }
+
+    struct MetricsShm m;
+    if (!metrics_shm_read(shm, &m)) {
+        fprintf(stderr, "[ERROR] Timed out waiting for a consistent snapshot\n");
+        return EXIT_FAILURE;
+    }
+    if (m.magic != SIGMIDI_METRICS_MAGIC || m.version != SIGMIDI_METRICS_VERSION ||
+        m.size != sizeof(struct MetricsShm)) {
+        fprintf(stderr, "[ERROR] Unsupported metrics layout (version %u, size %u)\n",
+                m.version, m.size);
+        return EXIT_FAILURE;
+    }
+
+    printf("# HELP sigmidi_events_total MIDI events received.\n");
+    printf("# TYPE sigmidi_events_total counter\n");
+    for (int i = 0; i < METRICS_EVT_COUNT; i++) {
+        printf("sigmidi_events_total{type=\"%s\"} %lu\n", event_type_names[i],
+               (unsigned long)m.events_total[i]);
+    }
+    printf("# HELP sigmidi_events_per_second MIDI events received per second.\n");
+    printf("# TYPE sigmidi_events_per_second gauge\n");
+    for (int i = 0; i < METRICS_EVT_COUNT; i++) {
+        printf("sigmidi_events_per_second{type=\"%s\"} %.3f\n", event_type_names[i],
+               m.events_per_sec[i]);
+    }
+
+    print_metric("live_notes", "gauge", "Notes currently held down.", m.live_notes);
+
+    printf("# HELP sigmidi_queue_size Items in the internal queues, the event queue at "
+           "its peak since the previous update.\n");
+    printf("# TYPE sigmidi_queue_size gauge\n");
+    printf("sigmidi_queue_size{queue=\"note_queue\"} %u\n", m.note_queue_size);
+    printf("sigmidi_queue_size{queue=\"event_queue\"} %u\n", m.event_queue_size);
+    printf("# HELP sigmidi_queue_capacity Allocated capacity of the internal queues.\n");
+    printf("# TYPE sigmidi_queue_capacity gauge\n");
+    printf("sigmidi_queue_capacity{queue=\"note_queue\"} %u\n", m.note_queue_capacity);
+    printf("sigmidi_queue_capacity{queue=\"event_queue\"} %u\n", m.event_queue_capacity);
+
+    print_metric("pool_bytes", "gauge", "Bytes held by notes, queues and snapshots.",
+                 m.pool_bytes);
+
+    print_metric("gc_runs_total", "counter",
+                 "Note queue garbage collections that freed notes.", m.gc_runs);
+    print_metric("gc_pause_seconds_total", "counter", "Time spent in note queue GC.",
+                 m.gc_pause_total_ns / 1e9);
+    print_metric("gc_pause_last_seconds", "gauge", "Duration of the last GC pause.",
+                 m.gc_pause_last_ns / 1e9);
+    print_metric("gc_pause_max_seconds", "gauge", "Longest GC pause.",
+                 m.gc_pause_max_ns / 1e9);
+
+    print_metric("frames_total", "counter", "Frames presented.", m.frames_total);
+    print_metric("frames_dropped_total", "counter",
+                 "Frames that took longer than 1.5 frame budgets.", m.frames_dropped);
+    print_metric("target_fps", "gauge", "Configured frame rate.", m.target_fps);
+
+    printf("# HELP sigmidi_frame_time_seconds Frame time over the last window.\n");
+    printf("# TYPE sigmidi_frame_time_seconds summary\n");
+    print_frame_time("0.5", m.frame_time_p50_ns);
+    print_frame_time("0.9", m.frame_time_p90_ns);
+    print_frame_time("0.99", m.frame_time_p99_ns);
+    print_frame_time("1", m.frame_time_max_ns);
+
+    return EXIT_SUCCESS;
+}
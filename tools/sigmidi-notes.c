@@ -0,0 +1,72 @@
+// Headless reader for the note stream of a running sigmidi, prints one line
+// per record
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SIGMIDI_STREAM_READER_IMPLEMENTATION
+#include <sigmidi-stream.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static const char *record_type_names[] = {
+    [NOTE_RECORD_BEGIN] = "begin",
+    [NOTE_RECORD_END] = "end",
+    [NOTE_RECORD_SUSTAIN] = "sustain",
+};
+
+int main() {
+    struct NoteStreamReader reader;
+    if (note_stream_attach(&reader) < 0) {
+        fprintf(stderr, "[ERROR] No note stream (%s), start sigmidi first\n",
+                SIGMIDI_STREAM_SHM_NAME);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    const struct timespec idle = {.tv_sec = 0, .tv_nsec = 1000000};
+    uint64_t reported_lost = 0;
+
+    while (running) {
+        const struct NoteRecord *rec = note_stream_peek(&reader);
+        if (rec == NULL) {
+            fflush(stdout);
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        // How long ago the record's time was, on the clock all processes share
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double record_ns = reader.shm->time_origin_ns + rec->time * 1e6;
+        double age_ms = ((double)now.tv_sec * 1e9 + now.tv_nsec - record_ns) / 1e6;
+
+        // Format first, the record is only known to be intact after consume
+        char line[128];
+        snprintf(line, sizeof(line),
+                 "%-7s id=%lu note=%u velocity=%u time=%d sustain=%d age=%.1fms",
+                 rec->type <= NOTE_RECORD_SUSTAIN ? record_type_names[rec->type] : "?",
+                 (unsigned long)rec->id, rec->note, rec->velocity, rec->time,
+                 rec->sus_duration, age_ms);
+        if (note_stream_consume(&reader)) {
+            puts(line);
+        }
+
+        if (reader.lost != reported_lost) {
+            fprintf(stderr, "[WARN] overrun, %lu records lost\n",
+                    (unsigned long)(reader.lost - reported_lost));
+            reported_lost = reader.lost;
+        }
+    }
+
+    note_stream_detach(&reader);
+    return EXIT_SUCCESS;
+}
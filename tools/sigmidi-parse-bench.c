@@ -0,0 +1,121 @@
+// Throughput of the raw MIDI parser. Parses a file, or a synthetic stream with
+// running status, interleaved clock bytes and SysEx, and prints MB/s and
+// events/s.
+#include <sigmidi-input.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNTHETIC_SIZE (64 << 20)
+#define MIN_TOTAL_BYTES (1ull << 30)
+
+static size_t synthetic_stream(uint8_t *buf, size_t size) {
+    size_t len = 0;
+    unsigned int rng = 1;
+
+    while (len + 16 < size) {
+        rng = rng * 1103515245 + 12345;
+        unsigned int r = rng >> 16;
+
+        switch (r % 16) {
+        case 0:
+            // Note on with an explicit status byte
+            buf[len++] = 0x90 | (r >> 4 & 0x0f);
+            break;
+        case 1:
+            buf[len++] = 0xf8;
+            break;
+        case 2:
+            buf[len++] = 0xb0;
+            buf[len++] = 64;
+            buf[len++] = r & 0x7f;
+            buf[len++] = 0x90;
+            break;
+        case 3:
+            buf[len++] = 0xf0;
+            for (int i = 0; i < 8; i++) {
+                buf[len++] = (r >> i) & 0x7f;
+            }
+            buf[len++] = 0xf7;
+            buf[len++] = 0x90;
+            break;
+        default:
+            break;
+        }
+
+        // Running status note on/off pair, a clock byte in between now and then
+        buf[len++] = 21 + (r >> 2) % 88;
+        buf[len++] = 1 + (r >> 9) % 127;
+        if (r % 7 == 0)
+            buf[len++] = 0xf8;
+        buf[len++] = 21 + (r >> 2) % 88;
+        buf[len++] = 0;
+    }
+    // Start from a known status
+    buf[0] = 0x90;
+    return len;
+}
+
+static size_t read_file(const char *path, uint8_t **buf) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[ERROR] Failed to open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    *buf = malloc(size > 0 ? size : 1);
+    size_t len = fread(*buf, 1, size, f);
+    fclose(f);
+    return len;
+}
+
+int main(int argc, char **argv) {
+    uint8_t *buf;
+    size_t len;
+
+    if (argc > 1) {
+        len = read_file(argv[1], &buf);
+    } else {
+        buf = malloc(SYNTHETIC_SIZE);
+        len = synthetic_stream(buf, SYNTHETIC_SIZE);
+    }
+    if (len == 0) {
+        fprintf(stderr, "[ERROR] Nothing to parse\n");
+        return EXIT_FAILURE;
+    }
+
+    struct RawMidiParser parser;
+    struct MidiEvent events[INPUT_BATCH_SIZE];
+    uint64_t total_bytes = 0;
+    uint64_t total_events = 0;
+    uint64_t checksum = 0;
+
+    uint64_t start_ns = monotonic_ns();
+    do {
+        rawmidi_parser_init(&parser);
+        size_t pos = 0;
+        while (pos < len) {
+            size_t consumed;
+            int n = rawmidi_parse(&parser, buf + pos, len - pos, events, INPUT_BATCH_SIZE,
+                                  0, 0, &consumed);
+            pos += consumed;
+            total_events += n;
+            // Keep the compiler from dropping the work
+            if (n > 0)
+                checksum += events[n - 1].note;
+        }
+        total_bytes += len;
+    } while (total_bytes < MIN_TOTAL_BYTES);
+    double seconds = (monotonic_ns() - start_ns) / 1e9;
+
+    printf("bytes:    %llu\n", (unsigned long long)total_bytes);
+    printf("events:   %llu\n", (unsigned long long)total_events);
+    printf("time:     %.3f s\n", seconds);
+    printf("MB/s:     %.1f\n", total_bytes / seconds / 1e6);
+    printf("events/s: %.1f M\n", total_events / seconds / 1e6);
+    printf("checksum: %llu\n", (unsigned long long)checksum);
+    return 0;
+}